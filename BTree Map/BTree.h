@@ -0,0 +1,1112 @@
+#pragma once
+#include "Tree.h"
+
+namespace mylib {
+	template<class ValueType, std::size_t NodeBytes>
+	struct BTreeInternalNode;
+
+	// Values are kept sorted inside the node. Internal nodes are leaves with count + 1 children appended, so both kinds
+	// are allocated at their own size. The capacity is chosen so that a leaf spans about NodeBytes bytes.
+	template<class ValueType, std::size_t NodeBytes>
+	struct BTreeNode {
+		using value_type	= ValueType;
+		using size_type		= std::size_t;
+		using InternalNode	= BTreeInternalNode<ValueType, NodeBytes>;
+
+		static constexpr size_type fitting_count	= (NodeBytes - sizeof(void*) - sizeof(size_type)) / sizeof(ValueType);
+		static constexpr size_type capacity			= fitting_count < 3 ? 3 : (fitting_count > 255 ? 255 : fitting_count);
+		static constexpr size_type min_count		= capacity / 2;
+
+		BTreeNode* parent;
+		unsigned char position;
+		unsigned char count;
+		bool is_leaf;
+		alignas(ValueType) unsigned char storage[capacity * sizeof(ValueType)];
+
+		[[nodiscard]] ValueType* slot(size_type index) noexcept {
+			return reinterpret_cast<ValueType*>(storage) + index;
+		}
+
+		[[nodiscard]] const ValueType* slot(size_type index) const noexcept {
+			return reinterpret_cast<const ValueType*>(storage) + index;
+		}
+
+		[[nodiscard]] BTreeNode*& child(size_type index) noexcept {
+			return static_cast<InternalNode*>(this)->children[index];
+		}
+
+		[[nodiscard]] BTreeNode* child(size_type index) const noexcept {
+			return static_cast<const InternalNode*>(this)->children[index];
+		}
+	};
+
+	template<class ValueType, std::size_t NodeBytes>
+	struct BTreeInternalNode : BTreeNode<ValueType, NodeBytes> {
+		BTreeNode<ValueType, NodeBytes>* children[BTreeNode<ValueType, NodeBytes>::capacity + 1];
+	};
+
+	template<class Node>
+	struct BTreeLocation {
+		Node* node;
+		std::size_t position;
+
+		[[nodiscard]] bool operator==(const BTreeLocation& rhs) const noexcept {
+			return node == rhs.node && position == rhs.position;
+		}
+
+		[[nodiscard]] bool operator!=(const BTreeLocation& rhs) const noexcept {
+			return !(*this == rhs);
+		}
+	};
+
+	template<class Node>
+	struct BTreeFindResult {
+		BTreeLocation<Node> location;
+		bool duplicate;
+	};
+
+	template<class BTreeValue>
+	class BTreeUncheckedIterator;
+
+	template<class BTreeValue>
+	class BTreeConstIterator;
+
+	template<class BTreeValue>
+	class BTreeIterator;
+
+	template<class Traits, std::size_t NodeBytes>
+	class BTreeValue : public ContainerBase {
+	public:
+		using allocator_type	= typename Traits::allocator_type;
+		using key_type			= typename Traits::key_type;
+		using value_type		= typename Traits::value_type;
+		using reference			= value_type&;
+		using const_reference	= const value_type&;
+		using key_compare		= typename Traits::key_compare;
+
+		using Node				= BTreeNode<value_type, NodeBytes>;
+		using InternalNode		= BTreeInternalNode<value_type, NodeBytes>;
+		using Alloc				= typename std::allocator_traits<allocator_type>::template rebind_alloc<Node>;
+		using AllocTraits		= std::allocator_traits<Alloc>;
+		using InternalAlloc		= typename AllocTraits::template rebind_alloc<InternalNode>;
+		using InternalAllocTraits = std::allocator_traits<InternalAlloc>;
+		using Location			= BTreeLocation<Node>;
+
+		using size_type			= typename AllocTraits::size_type;
+		using difference_type	= typename AllocTraits::difference_type;
+		using pointer			= typename AllocTraits::pointer;
+		using const_pointer		= typename AllocTraits::const_pointer;
+
+		using uncheked_iterator = BTreeUncheckedIterator<BTreeValue>;
+		using iterator			= BTreeIterator<BTreeValue>;
+		using const_iterator	= BTreeConstIterator<BTreeValue>;
+
+		template<class AnyKeyCompare, class AnyAlloc>
+		BTreeValue(AnyKeyCompare&& comp, AnyAlloc&& alloc) : comp{ std::forward<AnyKeyCompare>(comp) }, alloc{ std::forward<AnyAlloc>(alloc) },
+			root{}, leftmost{}, rightmost{}, size{} {}
+
+		[[nodiscard]] static const key_type& keyAt(const Node* node, size_type position) noexcept {
+			return Traits::getKeyFromValue(*node->slot(position));
+		}
+
+		[[nodiscard]] static decltype(auto) movableValue(value_type& value) noexcept {
+			if constexpr (std::is_same_v<value_type, const key_type>) return std::move(const_cast<key_type&>(value));
+			else return std::move(reinterpret_cast<std::pair<key_type, typename Traits::mapped_type>&>(value));
+		}
+
+		static void increment(Location& location) noexcept {
+			if (!location.node->is_leaf) {
+				location.node = location.node->child(location.position + 1);
+				while (!location.node->is_leaf) location.node = location.node->child(0);
+				location.position = 0;
+				return;
+			}
+			if (++location.position < location.node->count) return;
+
+			const Location leaf_end = location;
+			while (location.node->parent && location.position == location.node->count) {
+				location.position	= location.node->position;
+				location.node		= location.node->parent;
+			}
+			if (location.position == location.node->count) location = leaf_end; // stepped past the last value
+		}
+
+		static void decrement(Location& location) noexcept {
+			if (!location.node->is_leaf) {
+				location.node = location.node->child(location.position);
+				while (!location.node->is_leaf) location.node = location.node->child(location.node->count);
+				location.position = location.node->count - 1;
+				return;
+			}
+			while (location.node->parent && location.position == 0) {
+				location.position	= location.node->position;
+				location.node		= location.node->parent;
+			}
+			--location.position;
+		}
+
+		[[nodiscard]] Location beginLocation() const noexcept {
+			return { leftmost, 0 };
+		}
+
+		[[nodiscard]] Location endLocation() const noexcept {
+			return rightmost ? Location{ rightmost, rightmost->count } : Location{};
+		}
+
+		// std::less of a string orders it against a view of another string as against the string itself, so emplace looks
+		// views of its arguments up through std::less<>
+		static constexpr bool compares_views = std::is_same_v<key_compare, std::less<key_type>>;
+
+		template<class K>
+		[[nodiscard]] decltype(auto) lookupComp() const noexcept {
+			if constexpr (compares_views && !std::is_same_v<K, key_type>) return std::less<>{};
+			else return (comp);
+		}
+
+		// Keys are compared against every value of the node and the results are summed up, which has no branches to
+		// mispredict and lets the compiler vectorize the loop; for other keys it is a binary search.
+		template<class K>
+		[[nodiscard]] size_type lowerBoundInNode(const Node* node, const K& key) const noexcept {
+			const auto& lookup_comp = lookupComp<K>();
+			if constexpr (hasBranchlessSearch()) {
+				size_type position = 0;
+				for (size_type i = 0; i < node->count; ++i) position += lookup_comp(keyAt(node, i), key);
+				return position;
+			}
+			else {
+				size_type first = 0;
+				size_type count = node->count;
+				while (count) {
+					const size_type step = count / 2;
+					if (lookup_comp(keyAt(node, first + step), key)) {
+						first += step + 1;
+						count -= step + 1;
+					}
+					else count = step;
+				}
+				return first;
+			}
+		}
+
+		template<class K>
+		[[nodiscard]] size_type upperBoundInNode(const Node* node, const K& key) const noexcept {
+			const auto& lookup_comp = lookupComp<K>();
+			if constexpr (hasBranchlessSearch()) {
+				size_type position = 0;
+				for (size_type i = 0; i < node->count; ++i) position += !lookup_comp(key, keyAt(node, i));
+				return position;
+			}
+			else {
+				size_type first = 0;
+				size_type count = node->count;
+				while (count) {
+					const size_type step = count / 2;
+					if (!lookup_comp(key, keyAt(node, first + step))) {
+						first += step + 1;
+						count -= step + 1;
+					}
+					else count = step;
+				}
+				return first;
+			}
+		}
+
+		[[nodiscard]] static constexpr bool hasBranchlessSearch() noexcept {
+			return std::is_arithmetic_v<key_type> && (std::is_same_v<key_compare, std::less<key_type>> || std::is_same_v<key_compare, std::less<>>
+				|| std::is_same_v<key_compare, std::greater<key_type>> || std::is_same_v<key_compare, std::greater<>>);
+		}
+
+		template<class K>
+		[[nodiscard]] BTreeFindResult<Node> findPlace(const K& key) const noexcept {
+			const auto& lookup_comp = lookupComp<K>();
+			Node* node = root;
+			if (!node) return { {}, false };
+
+			while (true) {
+				const size_type position = lowerBoundInNode(node, key);
+				if (position < node->count && !lookup_comp(key, keyAt(node, position))) return { { node, position }, true };
+				if (node->is_leaf) return { { node, position }, false };
+				node = node->child(position);
+			}
+		}
+
+		template<class K>
+		[[nodiscard]] BTreeFindResult<Node> findPlaceWithHint(Location hint, const K& key) const noexcept {
+			const auto& lookup_comp = lookupComp<K>();
+			if (!root) return { {}, false };
+
+			if (hint == endLocation()) {
+				if (!rightmost->count || lookup_comp(keyAt(rightmost, rightmost->count - 1), key)) return { hint, false };
+			}
+			else if (lookup_comp(key, keyAt(hint.node, hint.position))) {
+				if (hint == beginLocation()) return { hint, false };
+				Location prev = hint;
+				decrement(prev);
+				if (lookup_comp(keyAt(prev.node, prev.position), key)) return { insertionPointBefore(hint), false };
+			}
+			else if (lookup_comp(keyAt(hint.node, hint.position), key)) {
+				Location next = hint;
+				increment(next);
+				if (next == endLocation() || lookup_comp(key, keyAt(next.node, next.position))) return { insertionPointBefore(next), false };
+			}
+			else return { hint, true };
+
+			return findPlace(key);
+		}
+
+		[[nodiscard]] static Location insertionPointBefore(Location location) noexcept {
+			if (location.node->is_leaf) return location;
+			Node* node = location.node->child(location.position);
+			while (!node->is_leaf) node = node->child(node->count);
+			return { node, node->count };
+		}
+
+		template<class K>
+		[[nodiscard]] Location lowerBoundLocation(const K& key) const noexcept {
+			Location result = endLocation();
+			Node* node = root;
+			while (node) {
+				const size_type position = lowerBoundInNode(node, key);
+				if (position < node->count) result = { node, position };
+				if (node->is_leaf) break;
+				node = node->child(position);
+			}
+			return result;
+		}
+
+		template<class K>
+		[[nodiscard]] Location upperBoundLocation(const K& key) const noexcept {
+			Location result = endLocation();
+			Node* node = root;
+			while (node) {
+				const size_type position = upperBoundInNode(node, key);
+				if (position < node->count) result = { node, position };
+				if (node->is_leaf) break;
+				node = node->child(position);
+			}
+			return result;
+		}
+
+		[[nodiscard]] Node* createNode(bool is_leaf) {
+			Node* node;
+			if (is_leaf) node = ::new(static_cast<void*>(unfancy(alloc.allocate(1)))) Node; // throws
+			else {
+				InternalAlloc internal_alloc(alloc);
+				InternalNode* internal_node = ::new(static_cast<void*>(unfancy(internal_alloc.allocate(1)))) InternalNode; // throws
+				std::fill(std::begin(internal_node->children), std::end(internal_node->children), nullptr);
+				node = internal_node;
+			}
+			node->parent	= nullptr;
+			node->position	= 0;
+			node->count		= 0;
+			node->is_leaf	= is_leaf;
+			return node;
+		}
+
+		void freeNode(Node* node) noexcept {
+			if (node->is_leaf) alloc.deallocate(std::pointer_traits<typename AllocTraits::pointer>::pointer_to(*node), 1);
+			else {
+				InternalAlloc internal_alloc(alloc);
+				internal_alloc.deallocate(std::pointer_traits<typename InternalAllocTraits::pointer>::pointer_to(static_cast<InternalNode&>(*node)), 1);
+			}
+		}
+
+		void freeSubtree(Node* node) noexcept {
+			for (size_type i = 0; i < node->count; ++i) destroy(alloc, node->slot(i));
+			if (!node->is_leaf) {
+				for (size_type i = 0; i <= node->count; ++i) {
+					if (node->child(i)) freeSubtree(node->child(i));
+				}
+			}
+			freeNode(node);
+		}
+
+		static void setChild(Node* node, size_type position, Node* child) noexcept {
+			node->child(position)	= child;
+			child->parent			= node;
+			child->position			= static_cast<unsigned char>(position);
+		}
+
+		// Moves a value to a free slot. When the value is the one tracked by erase, the tracked location follows it.
+		// Splits and shifts move many values in a row and cannot undo a move that throws halfway through, so the moves
+		// may not throw.
+		void relocate(Node* dst, size_type dst_position, Node* src, size_type src_position, Location* tracked) noexcept {
+			static_assert(std::is_nothrow_move_constructible_v<std::remove_reference_t<decltype(movableValue(*src->slot(src_position)))>>,
+				"Values of a BTree have to be nothrow move constructible");
+			construct(alloc, dst->slot(dst_position), movableValue(*src->slot(src_position)));
+			destroy(alloc, src->slot(src_position));
+			if (tracked && tracked->node == src && tracked->position == src_position) *tracked = { dst, dst_position };
+		}
+
+		// Makes room in a full node by moving the values after the split point into a new right sibling and the value at
+		// the split point up into the parent, which is split beforehand when it is full too. The split point leans to the
+		// side the next value goes to, so ascending and descending runs leave full nodes behind instead of half-empty ones.
+		// Every node a split needs is allocated before any value moves, so a split either throws having changed nothing
+		// or cannot throw any more.
+		void splitNode(Node* node, size_type insert_position) {
+			Node* right = createNode(node->is_leaf); // throws
+			try {
+				if (node == root) {
+					Node* new_root = createNode(false); // throws
+					setChild(new_root, 0, node);
+					root = new_root;
+				}
+				else if (node->parent->count == Node::capacity) splitNode(node->parent, node->position); // throws
+			}
+			catch (...) {
+				freeNode(right);
+				throw;
+			}
+
+			size_type left_count = Node::capacity / 2;
+			if (insert_position == Node::capacity) left_count = Node::capacity - 1;
+			else if (insert_position == 0) left_count = 0;
+
+			const size_type count = node->count;
+			for (size_type i = left_count + 1; i < count; ++i) relocate(right, i - left_count - 1, node, i, nullptr);
+			if (!node->is_leaf) {
+				for (size_type i = left_count + 1; i <= count; ++i) setChild(right, i - left_count - 1, node->child(i));
+			}
+			right->count = static_cast<unsigned char>(count - left_count - 1);
+
+			Node* parent = node->parent;
+			const size_type position = node->position;
+			for (size_type i = parent->count; i > position; --i) relocate(parent, i, parent, i - 1, nullptr);
+			for (size_type i = parent->count + 1; i > position + 1; --i) setChild(parent, i, parent->child(i - 1));
+			relocate(parent, position, node, left_count, nullptr);
+			setChild(parent, position + 1, right);
+			++parent->count;
+
+			node->count = static_cast<unsigned char>(left_count);
+			if (node == rightmost) rightmost = right;
+		}
+
+		// When a node has to be allocated, the value is built aside first and moved in afterwards, so a throwing
+		// constructor leaves no empty node or split behind.
+		template<class... Args>
+		Location insertValue(Location location, Args&&... args) {
+			orphanAll();
+
+			if (root && location.node->count != Node::capacity) {
+				Node* node = location.node;
+				for (size_type i = node->count; i > location.position; --i) relocate(node, i, node, i - 1, nullptr);
+				try {
+					construct(alloc, node->slot(location.position), std::forward<Args>(args)...);
+				}
+				catch (...) {
+					for (size_type i = location.position; i < node->count; ++i) relocate(node, i, node, i + 1, nullptr);
+					throw;
+				}
+			}
+			else {
+				alignas(value_type) unsigned char storage[sizeof(value_type)];
+				value_type* value = reinterpret_cast<value_type*>(storage);
+				construct(alloc, value, std::forward<Args>(args)...); // throws
+				try {
+					if (!root) {
+						root = leftmost = rightmost = createNode(true); // throws
+						location = { root, 0 };
+					}
+					else {
+						splitNode(location.node, location.position); // throws
+						if (location.position > location.node->count) {
+							location.position	-= location.node->count + 1;
+							location.node		= location.node->parent->child(location.node->position + 1);
+						}
+					}
+				}
+				catch (...) {
+					destroy(alloc, value);
+					throw;
+				}
+
+				Node* node = location.node;
+				for (size_type i = node->count; i > location.position; --i) relocate(node, i, node, i - 1, nullptr);
+				construct(alloc, node->slot(location.position), movableValue(*value));
+				destroy(alloc, value);
+			}
+			++location.node->count;
+			++size;
+			return location;
+		}
+
+		// Removes the value and returns the location of the value that followed it. A value of an internal node is
+		// replaced by its predecessor from a leaf, so values are only ever taken out of leaves.
+		Location eraseValue(Location location) {
+			orphanAll();
+
+			Node* leaf = location.node;
+			Location next = location;
+			const bool internal_erase = !leaf->is_leaf;
+
+			destroy(alloc, location.node->slot(location.position));
+			if (internal_erase) {
+				leaf = location.node->child(location.position);
+				while (!leaf->is_leaf) leaf = leaf->child(leaf->count);
+				relocate(location.node, location.position, leaf, leaf->count - 1, nullptr);
+			}
+			else {
+				for (size_type i = location.position + 1; i < leaf->count; ++i) relocate(leaf, i - 1, leaf, i, nullptr);
+			}
+			--leaf->count;
+			--size;
+
+			if (!internal_erase && next.position == leaf->count) {
+				while (next.node->parent && next.position == next.node->count) {
+					next.position	= next.node->position;
+					next.node		= next.node->parent;
+				}
+				if (next.position == next.node->count) next.node = nullptr; // the last value was erased
+			}
+
+			rebalance(leaf, &next);
+
+			if (!next.node) return endLocation();
+			if (internal_erase) increment(next);
+			return next;
+		}
+
+		void rebalance(Node* node, Location* tracked) {
+			while (node != root && node->count < Node::min_count) {
+				Node* parent = node->parent;
+				Node* left	= node->position > 0 ? parent->child(node->position - 1) : nullptr;
+				Node* right = node->position < parent->count ? parent->child(node->position + 1) : nullptr;
+
+				if (left && left->count + node->count < Node::capacity) mergeNodes(left, node, tracked);
+				else if (right && node->count + right->count < Node::capacity) mergeNodes(node, right, tracked);
+				else {
+					if (left && (!right || left->count >= right->count)) moveFromLeft(left, node, tracked);
+					else moveFromRight(node, right, tracked);
+					break;
+				}
+				node = parent;
+			}
+
+			if (root->count == 0) {
+				Node* old_root = root;
+				if (root->is_leaf) root = leftmost = rightmost = nullptr;
+				else {
+					root			= root->child(0);
+					root->parent	= nullptr;
+					root->position	= 0;
+				}
+				freeNode(old_root);
+			}
+		}
+
+		// Appends the separator and all values of right to left and frees right.
+		void mergeNodes(Node* left, Node* right, Location* tracked) {
+			Node* parent = left->parent;
+			const size_type position	= left->position;
+			const size_type offset		= left->count;
+
+			relocate(left, offset, parent, position, tracked);
+			for (size_type i = 0; i < right->count; ++i) relocate(left, offset + 1 + i, right, i, tracked);
+			if (!left->is_leaf) {
+				for (size_type i = 0; i <= right->count; ++i) setChild(left, offset + 1 + i, right->child(i));
+			}
+			left->count += right->count + 1;
+
+			for (size_type i = position + 1; i < parent->count; ++i) relocate(parent, i - 1, parent, i, tracked);
+			for (size_type i = position + 2; i <= parent->count; ++i) setChild(parent, i - 1, parent->child(i));
+			--parent->count;
+
+			if (right == rightmost) rightmost = left;
+			freeNode(right);
+		}
+
+		// Rotates values from the left sibling through the separator until both nodes hold about the same number.
+		void moveFromLeft(Node* left, Node* node, Location* tracked) {
+			Node* parent = node->parent;
+			const size_type separator	= left->position;
+			const size_type moved		= (left->count - node->count + 1) / 2;
+			const size_type left_count	= left->count - moved;
+
+			for (size_type i = node->count; i-- > 0;) relocate(node, i + moved, node, i, tracked);
+			if (!node->is_leaf) {
+				for (size_type i = node->count + 1; i-- > 0;) setChild(node, i + moved, node->child(i));
+			}
+
+			relocate(node, moved - 1, parent, separator, tracked);
+			for (size_type i = 0; i + 1 < moved; ++i) relocate(node, i, left, left_count + 1 + i, tracked);
+			relocate(parent, separator, left, left_count, tracked);
+			if (!node->is_leaf) {
+				for (size_type i = 0; i < moved; ++i) setChild(node, i, left->child(left_count + 1 + i));
+			}
+
+			left->count = static_cast<unsigned char>(left_count);
+			node->count += static_cast<unsigned char>(moved);
+		}
+
+		void moveFromRight(Node* node, Node* right, Location* tracked) {
+			Node* parent = node->parent;
+			const size_type separator	= node->position;
+			const size_type moved		= (right->count - node->count + 1) / 2;
+			const size_type offset		= node->count;
+
+			relocate(node, offset, parent, separator, tracked);
+			for (size_type i = 0; i + 1 < moved; ++i) relocate(node, offset + 1 + i, right, i, tracked);
+			relocate(parent, separator, right, moved - 1, tracked);
+			if (!node->is_leaf) {
+				for (size_type i = 0; i < moved; ++i) setChild(node, offset + 1 + i, right->child(i));
+			}
+
+			for (size_type i = moved; i < right->count; ++i) relocate(right, i - moved, right, i, tracked);
+			if (!right->is_leaf) {
+				for (size_type i = moved; i <= right->count; ++i) setChild(right, i - moved, right->child(i));
+			}
+
+			node->count += static_cast<unsigned char>(moved);
+			right->count -= static_cast<unsigned char>(moved);
+		}
+
+		key_compare comp;
+		Alloc alloc;
+		Node* root;
+		Node* leftmost;
+		Node* rightmost;
+		size_type size;
+	};
+
+	template<class Traits, std::size_t NodeBytes>
+	class BTree {
+	public:
+		using allocator_type	= typename Traits::allocator_type;
+		using key_type			= typename Traits::key_type;
+		using value_type		= typename Traits::value_type;
+		using key_compare		= typename Traits::key_compare;
+
+	protected:
+		using BTreeValue		= BTreeValue<Traits, NodeBytes>;
+		using Node				= typename BTreeValue::Node;
+		using Alloc				= typename BTreeValue::Alloc;
+		using AllocTraits		= typename BTreeValue::AllocTraits;
+		using Location			= typename BTreeValue::Location;
+		using uncheked_iterator = BTreeUncheckedIterator<BTreeValue>;
+
+	public:
+		using size_type			= typename AllocTraits::size_type;
+		using difference_type	= typename AllocTraits::difference_type;
+		using pointer			= typename std::allocator_traits<allocator_type>::pointer;
+		using const_pointer		= typename std::allocator_traits<allocator_type>::const_pointer;
+		using reference			= value_type&;
+		using const_reference	= const value_type&;
+
+		using iterator			= BTreeIterator<BTreeValue>;
+		using const_iterator	= BTreeConstIterator<BTreeValue>;
+
+		BTree(const key_compare& comp, const allocator_type& alloc) : tree_value(comp, alloc) {
+			createProxy();
+		}
+
+		template<class AnyAllocator>
+		BTree(const BTree& other, AnyAllocator&& alloc) : tree_value(other.tree_value.comp, std::forward<AnyAllocator>(alloc)) {
+			createProxy();
+			copyOrMoveAllNodes(other, CopyTag{});
+		}
+
+		template<class AnyAllocator>
+		BTree(BTree&& other, AnyAllocator&& alloc) : tree_value(other.tree_value.comp, std::forward<AnyAllocator>(alloc)) {
+			createProxy();
+			if constexpr (!AllocTraits::is_always_equal::value) {
+				if (tree_value.alloc != other.tree_value.alloc) {
+					copyOrMoveAllNodes(other, MoveTag{});
+					other.clear();
+					return;
+				}
+			}
+			swapTreeValue(other);
+		}
+
+		BTree& operator=(const BTree& other) {
+			if (this == &other) return *this;
+
+			clear();
+			tree_value.comp = other.tree_value.comp;
+			if constexpr (!AllocTraits::is_always_equal::value && AllocTraits::propagate_on_container_copy_assignment::value) {
+				if (tree_value.alloc != other.tree_value.alloc) {
+					deleteProxy();
+					tree_value.alloc = other.tree_value.alloc;
+					createProxy();
+				}
+			}
+			copyOrMoveAllNodes(other, CopyTag{});
+			return *this;
+		}
+
+		BTree& operator=(BTree&& other) {
+			if (this == &other) return *this;
+
+			clear();
+			if constexpr (!AllocTraits::is_always_equal::value) {
+				if (tree_value.alloc != other.tree_value.alloc) {
+					tree_value.comp = other.tree_value.comp;
+					if constexpr (AllocTraits::propagate_on_container_move_assignment::value) {
+						deleteProxy();
+						tree_value.alloc = std::move(other.tree_value.alloc);
+						createProxy();
+						other.tree_value.orphanAll();
+						swapNodes(other);
+					}
+					else {
+						copyOrMoveAllNodes(other, MoveTag{});
+						other.clear();
+					}
+					return *this;
+				}
+			}
+			swapTreeValue(other);
+			return *this;
+		}
+
+		void swap(BTree& other) {
+			if (this == &other) return;
+			if constexpr (!AllocTraits::propagate_on_container_swap::value) assert(!"propagate_on_container_swap = false");
+
+			std::swap(tree_value.alloc, other.tree_value.alloc);
+			swapTreeValue(other);
+		}
+
+		~BTree() {
+			clear();
+			deleteProxy();
+		}
+
+		template<class Tag>
+		void copyOrMoveAllNodes(const BTree& other, Tag tag) {
+			if (!other.tree_value.root) return;
+
+			try {
+				copyOrMoveSubtree(tree_value.root, nullptr, 0, other.tree_value.root, tag);
+			}
+			catch (...) {
+				if (tree_value.root) tree_value.freeSubtree(tree_value.root);
+				tree_value.root = nullptr;
+				throw;
+			}
+
+			Node* node = tree_value.root;
+			while (!node->is_leaf) node = node->child(0);
+			tree_value.leftmost = node;
+
+			node = tree_value.root;
+			while (!node->is_leaf) node = node->child(node->count);
+			tree_value.rightmost = node;
+
+			tree_value.size = other.tree_value.size;
+		}
+
+		template<class Tag>
+		void copyOrMoveSubtree(Node*& target, Node* parent, size_type position, Node* source, Tag tag) {
+			Node* node = tree_value.createNode(source->is_leaf); // throws
+			node->parent	= parent;
+			node->position	= static_cast<unsigned char>(position);
+			target			= node;
+
+			for (size_type i = 0; i < source->count; ++i) {
+				if constexpr (std::is_same_v<Tag, MoveTag>) construct(tree_value.alloc, node->slot(i), tree_value.movableValue(*source->slot(i))); // throws
+				else construct(tree_value.alloc, node->slot(i), *source->slot(i)); // throws
+				++node->count;
+			}
+			if (!source->is_leaf) {
+				for (size_type i = 0; i <= source->count; ++i) copyOrMoveSubtree(node->child(i), node, i, source->child(i), tag);
+			}
+		}
+
+		void clear() {
+			tree_value.orphanAll();
+			if (tree_value.root) tree_value.freeSubtree(tree_value.root);
+			tree_value.root			= nullptr;
+			tree_value.leftmost		= nullptr;
+			tree_value.rightmost	= nullptr;
+			tree_value.size			= 0;
+		}
+
+		void swapNodes(BTree& other) noexcept {
+			std::swap(tree_value.root, other.tree_value.root);
+			std::swap(tree_value.leftmost, other.tree_value.leftmost);
+			std::swap(tree_value.rightmost, other.tree_value.rightmost);
+			std::swap(tree_value.comp, other.tree_value.comp);
+			std::swap(tree_value.size, other.tree_value.size);
+		}
+
+		void swapTreeValue(BTree& other) {
+			swapNodes(other);
+			std::swap(tree_value.proxy, other.tree_value.proxy);
+
+			other.tree_value.proxy->parent = &other.tree_value;
+			tree_value.proxy->parent = &tree_value;
+		}
+
+		void createProxy() {
+			tree_value.createProxy(static_cast<typename AllocTraits::template rebind_alloc<IteratorProxy>>(tree_value.alloc));
+		}
+
+		void deleteProxy() {
+			tree_value.orphanAll();
+			tree_value.deleteProxy(static_cast<typename AllocTraits::template rebind_alloc<IteratorProxy>>(tree_value.alloc));
+		}
+
+		std::pair<iterator, bool> insert(const value_type& value) {
+			return emplace(value);
+		}
+
+		std::pair<iterator, bool> insert(value_type&& value) {
+			return emplace(std::move(value));
+		}
+
+		template<class InputIt>
+		void insert(InputIt first, InputIt last) {
+			while (first != last) {
+				emplaceHint_(tree_value.endLocation(), *first);
+				++first;
+			}
+		}
+
+		void insert(std::initializer_list<value_type> init) {
+			insert(init.begin(), init.end());
+		}
+
+		template<class... Args>
+		std::pair<iterator, bool> emplace(Args&&... args) {
+			std::pair<Location, bool> result = emplace_(std::forward<Args>(args)...);
+			return { iterator(&tree_value, result.first), result.second };
+		}
+
+		template<class... Args>
+		std::pair<Location, bool> emplace_(Args&&... args) {
+			using KeyExtractor = typename Traits::template KeyExtractor<std::decay_t<Args>...>;
+			if constexpr (KeyExtractor::extractable) {
+				auto&& key = KeyExtractor::template extract<BTreeValue::compares_views>(args...);
+				BTreeFindResult<Node> result = tree_value.findPlace(key);
+				if (result.duplicate) return { result.location, false };
+				checkGrow();
+				return { makeWithLookupKey<KeyExtractor>(std::forward<decltype(key)>(key), [this, &result](auto&&... value_args) {
+					return tree_value.insertValue(result.location, std::forward<decltype(value_args)>(value_args)...);
+				}, std::forward<Args>(args)...), true };
+			}
+			else {
+				value_type value(std::forward<Args>(args)...);
+				BTreeFindResult<Node> result = tree_value.findPlace(Traits::getKeyFromValue(value));
+				if (result.duplicate) return { result.location, false };
+				checkGrow();
+				return { tree_value.insertValue(result.location, tree_value.movableValue(value)), true };
+			}
+		}
+
+		template<class... Args>
+		iterator emplaceHint(const_iterator hint, Args&&... args) {
+			assert(hint.getContainer() == &tree_value && "Iterator from another container");
+			return iterator(&tree_value, emplaceHint_(hint.location(), std::forward<Args>(args)...));
+		}
+
+		template<class... Args>
+		Location emplaceHint_(Location hint, Args&&... args) {
+			using KeyExtractor = typename Traits::template KeyExtractor<std::decay_t<Args>...>;
+			if constexpr (KeyExtractor::extractable) {
+				auto&& key = KeyExtractor::template extract<BTreeValue::compares_views>(args...);
+				BTreeFindResult<Node> result = tree_value.findPlaceWithHint(hint, key);
+				if (result.duplicate) return result.location;
+				checkGrow();
+				return makeWithLookupKey<KeyExtractor>(std::forward<decltype(key)>(key), [this, &result](auto&&... value_args) {
+					return tree_value.insertValue(result.location, std::forward<decltype(value_args)>(value_args)...);
+				}, std::forward<Args>(args)...);
+			}
+			else {
+				value_type value(std::forward<Args>(args)...);
+				BTreeFindResult<Node> result = tree_value.findPlaceWithHint(hint, Traits::getKeyFromValue(value));
+				if (result.duplicate) return result.location;
+				checkGrow();
+				return tree_value.insertValue(result.location, tree_value.movableValue(value));
+			}
+		}
+
+		size_type count(const key_type& key) const noexcept {
+			return tree_value.findPlace(key).duplicate ? size_type{ 1 } : size_type{ 0 };
+		}
+
+		iterator find(const key_type& key) noexcept {
+			BTreeFindResult<Node> result = tree_value.findPlace(key);
+			return result.duplicate ? iterator(&tree_value, result.location) : end();
+		}
+
+		const_iterator find(const key_type& key) const noexcept {
+			BTreeFindResult<Node> result = tree_value.findPlace(key);
+			return result.duplicate ? const_iterator(&tree_value, result.location) : cend();
+		}
+
+		bool contains(const key_type& key) const noexcept {
+			return tree_value.findPlace(key).duplicate;
+		}
+
+		[[nodiscard]] iterator lowerBound(const key_type& key) noexcept {
+			return iterator(&tree_value, tree_value.lowerBoundLocation(key));
+		}
+
+		[[nodiscard]] const_iterator lowerBound(const key_type& key) const noexcept {
+			return const_iterator(&tree_value, tree_value.lowerBoundLocation(key));
+		}
+
+		[[nodiscard]] iterator upperBound(const key_type& key) noexcept {
+			return iterator(&tree_value, tree_value.upperBoundLocation(key));
+		}
+
+		[[nodiscard]] const_iterator upperBound(const key_type& key) const noexcept {
+			return const_iterator(&tree_value, tree_value.upperBoundLocation(key));
+		}
+
+		[[nodiscard]] std::pair<iterator, iterator> equalRange(const key_type& key) noexcept {
+			return { lowerBound(key), upperBound(key) };
+		}
+
+		[[nodiscard]] std::pair<const_iterator, const_iterator> equalRange(const key_type& key) const noexcept {
+			return { lowerBound(key), upperBound(key) };
+		}
+
+		iterator erase(const_iterator iter) {
+			assert(iter.getContainer() == &tree_value && "Iterator from another container");
+			assert(iter.location() != tree_value.endLocation() && "Cannot erase the end");
+			return iterator(&tree_value, tree_value.eraseValue(iter.location()));
+		}
+
+		iterator erase(iterator iter) {
+			return erase(const_iterator(iter));
+		}
+
+		iterator erase(const_iterator first, const_iterator last) {
+			assert(first.getContainer() == &tree_value && last.getContainer() == &tree_value && "Iterator from another container");
+			if (first.location() == tree_value.beginLocation() && last.location() == tree_value.endLocation()) {
+				clear();
+				return end();
+			}
+
+			size_type count = 0;
+			for (Location it = first.location(); it != last.location(); tree_value.increment(it)) ++count;
+
+			Location location = first.location();
+			while (count--) location = tree_value.eraseValue(location);
+			return iterator(&tree_value, location);
+		}
+
+		iterator erase(iterator first, iterator last) {
+			return erase(const_iterator(first), const_iterator(last));
+		}
+
+		size_type erase(const key_type& key) {
+			BTreeFindResult<Node> result = tree_value.findPlace(key);
+			if (!result.duplicate) return static_cast<size_type>(0);
+			tree_value.eraseValue(result.location);
+			return static_cast<size_type>(1);
+		}
+
+		void checkGrow() const noexcept {
+			assert(maxSize() != tree_value.size && "The lack of memory error");
+		}
+
+		[[nodiscard]] size_type size() const noexcept {
+			return tree_value.size;
+		}
+
+		[[nodiscard]] bool empty() const noexcept {
+			return tree_value.size == size_type{ 0 };
+		}
+
+		[[nodiscard]] size_type maxSize() const noexcept {
+			return std::min(static_cast<size_type>(std::numeric_limits<difference_type>::max()), AllocTraits::max_size(tree_value.alloc));
+		}
+
+		[[nodiscard]] iterator begin() noexcept {
+			return iterator(&tree_value, tree_value.beginLocation());
+		}
+
+		[[nodiscard]] const_iterator begin() const noexcept {
+			return const_iterator(&tree_value, tree_value.beginLocation());
+		}
+
+		[[nodiscard]] const_iterator cbegin() const noexcept {
+			return begin();
+		}
+
+		[[nodiscard]] iterator end() noexcept {
+			return iterator(&tree_value, tree_value.endLocation());
+		}
+
+		[[nodiscard]] const_iterator end() const noexcept {
+			return const_iterator(&tree_value, tree_value.endLocation());
+		}
+
+		[[nodiscard]] const_iterator cend() const noexcept {
+			return end();
+		}
+
+		BTreeValue tree_value;
+	};
+
+	template<class BTreeValue>
+	class BTreeUncheckedIterator : public IteratorBase {
+	public:
+		using Node			= typename BTreeValue::Node;
+		using Location		= typename BTreeValue::Location;
+		using value_type	= typename BTreeValue::value_type;
+		using diffence_type = typename BTreeValue::difference_type;
+		using reference		= value_type&;
+		using pointer		= value_type*;
+
+		BTreeUncheckedIterator() : node{}, position{} {}
+
+		BTreeUncheckedIterator(const BTreeValue* container, Location location) : node{ location.node }, position{ location.position } {
+			this->adopt(container);
+		}
+
+		[[nodiscard]] Location location() const noexcept {
+			return { node, position };
+		}
+
+		[[nodiscard]] reference operator*() noexcept {
+			return *node->slot(position);
+		}
+
+		[[nodiscard]] pointer operator->() noexcept {
+			return node->slot(position);
+		}
+
+		BTreeUncheckedIterator& operator++() noexcept {
+			Location next = location();
+			BTreeValue::increment(next);
+			node		= next.node;
+			position	= next.position;
+			return *this;
+		}
+
+		BTreeUncheckedIterator operator++(int) noexcept {
+			BTreeUncheckedIterator tmp = *this;
+			++*this;
+			return tmp;
+		}
+
+		BTreeUncheckedIterator& operator--() noexcept {
+			Location prev = location();
+			BTreeValue::decrement(prev);
+			node		= prev.node;
+			position	= prev.position;
+			return *this;
+		}
+
+		BTreeUncheckedIterator operator--(int) noexcept {
+			BTreeUncheckedIterator tmp = *this;
+			--*this;
+			return tmp;
+		}
+
+		[[nodiscard]] bool operator==(const BTreeUncheckedIterator& rhs) const noexcept {
+			return node == rhs.node && position == rhs.position;
+		}
+
+		[[nodiscard]] bool operator!=(const BTreeUncheckedIterator& rhs) const noexcept {
+			return !(*this == rhs);
+		}
+
+		Node* node;
+		std::size_t position;
+	};
+
+	template<class BTreeValue>
+	class BTreeConstIterator : public BTreeUncheckedIterator<BTreeValue> {
+	public:
+		using Base			= BTreeUncheckedIterator<BTreeValue>;
+		using value_type	= typename BTreeValue::value_type;
+		using diffence_type	= typename BTreeValue::difference_type;
+		using reference		= const value_type&;
+		using pointer		= const value_type*;
+
+		using Base::Base;
+
+		[[nodiscard]] reference operator*() const noexcept {
+			assert(this->getContainer() && "Invalid iterator error");
+			assert(this->node && this->position < this->node->count && "The try of dereferencing end");
+			return *this->node->slot(this->position);
+		}
+
+		[[nodiscard]] pointer operator->() const noexcept {
+			assert(this->getContainer() && "Invalid iterator error");
+			assert(this->node && this->position < this->node->count && "The try of dereferencing end");
+			return this->node->slot(this->position);
+		}
+
+		BTreeConstIterator& operator++() noexcept {
+			assert(this->getContainer() && "Invalid iterator error");
+			assert(this->node && this->position < this->node->count && "Incrementing the end error");
+			Base::operator++();
+			return *this;
+		}
+
+		BTreeConstIterator operator++(int) noexcept {
+			BTreeConstIterator tmp = *this;
+			++*this;
+			return tmp;
+		}
+
+		BTreeConstIterator& operator--() noexcept {
+			assert(this->getContainer() && "Invalid iterator error");
+			assert(this->location() != static_cast<const BTreeValue*>(this->getContainer())->beginLocation() && "Decrementing the begin error");
+			Base::operator--();
+			return *this;
+		}
+
+		BTreeConstIterator operator--(int) noexcept {
+			BTreeConstIterator tmp = *this;
+			--*this;
+			return tmp;
+		}
+
+		[[nodiscard]] bool operator==(const BTreeConstIterator& rhs) const noexcept {
+			return (this->getContainer() && rhs.getContainer()) ? Base::operator==(rhs) : false;
+		}
+
+		[[nodiscard]] bool operator!=(const BTreeConstIterator& rhs) const noexcept {
+			return !(*this == rhs);
+		}
+	};
+
+	template<class BTreeValue>
+	class BTreeIterator : public BTreeConstIterator<BTreeValue> {
+	public:
+		using Base			= BTreeConstIterator<BTreeValue>;
+		using value_type	= typename BTreeValue::value_type;
+		using diffence_type = typename BTreeValue::difference_type;
+		using reference		= value_type&;
+		using pointer		= value_type*;
+
+		using Base::Base;
+
+		[[nodiscard]] reference operator*() const noexcept {
+			return const_cast<reference>(Base::operator*());
+		}
+
+		[[nodiscard]] pointer operator->() const noexcept {
+			return const_cast<pointer>(Base::operator->());
+		}
+
+		BTreeIterator& operator++() noexcept {
+			Base::operator++();
+			return *this;
+		}
+
+		BTreeIterator operator++(int) noexcept {
+			BTreeIterator tmp = *this;
+			++*this;
+			return tmp;
+		}
+
+		BTreeIterator& operator--() noexcept {
+			Base::operator--();
+			return *this;
+		}
+
+		BTreeIterator operator--(int) noexcept {
+			BTreeIterator tmp = *this;
+			--*this;
+			return tmp;
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,160 @@
+#pragma once
+#include <stdexcept>
+#include "BTree.h"
+
+namespace mylib {
+	// An ordered map that keeps many values per node, so a lookup touches a few cache lines per level instead of
+	// one node per comparison. Any insertion or erasure invalidates all iterators, as values move between nodes.
+	template<class Key, class T, class Compare = std::less<Key>, class Allocator = std::allocator<std::pair<const Key, T>>, std::size_t NodeBytes = 256>
+	class BTreeMap : public BTree<MapTraits<Key, T, Compare, Allocator>, NodeBytes> {
+	public:
+		using Base				= BTree<MapTraits<Key, T, Compare, Allocator>, NodeBytes>;
+		using allocator_type	= typename Base::allocator_type;
+		using key_type			= typename Base::key_type;
+		using mapped_type		= T;
+		using value_type		= typename Base::value_type;
+		using key_compare		= typename Base::key_compare;
+
+	protected:
+		using BTreeValue		= typename Base::BTreeValue;
+		using Node				= typename Base::Node;
+		using AllocTraits		= typename Base::AllocTraits;
+		using Location			= typename Base::Location;
+
+	public:
+		using size_type			= typename Base::size_type;
+		using difference_type	= typename Base::difference_type;
+		using pointer			= typename Base::pointer;
+		using const_pointer		= typename Base::const_pointer;
+		using reference			= value_type&;
+		using const_reference	= const value_type&;
+
+		using iterator			= typename Base::iterator;
+		using const_iterator	= typename Base::const_iterator;
+
+		BTreeMap() : Base(Compare{}, Allocator{}) {}
+
+		explicit BTreeMap(const Compare& comp, const Allocator& alloc = Allocator()) : Base(comp, alloc) {}
+
+		explicit BTreeMap(const Allocator& alloc) : Base(Compare{}, alloc) {}
+
+		template<class InputIt>
+		BTreeMap(InputIt first, InputIt last, const Compare& comp = Compare(), const Allocator& alloc = Allocator()) : Base(comp, alloc) {
+			this->insert(first, last);
+		}
+
+		template<class InputIt>
+		BTreeMap(InputIt first, InputIt last, const Allocator& alloc) : Base(Compare{}, alloc) {
+			this->insert(first, last);
+		}
+
+		BTreeMap(const BTreeMap& other) : Base(other, AllocTraits::select_on_container_copy_construction(other.tree_value.alloc)) {}
+
+		BTreeMap(const BTreeMap& other, const Allocator& alloc) : Base(other, alloc) {}
+
+		BTreeMap(BTreeMap&& other) : Base(std::move(other), std::move(other.tree_value.alloc)) {}
+
+		BTreeMap(BTreeMap&& other, const Allocator& alloc) : Base(std::move(other), alloc) {}
+
+		BTreeMap(std::initializer_list<value_type> init, const Compare& comp = Compare(), const Allocator& alloc = Allocator()) : Base(comp, alloc) {
+			this->insert(init);
+		}
+
+		BTreeMap(std::initializer_list<value_type> init, const Allocator alloc) : Base(Compare{}, alloc) {
+			this->insert(init);
+		}
+
+		BTreeMap& operator=(const BTreeMap& other) = default;
+
+		BTreeMap& operator=(BTreeMap&& other) = default;
+
+		using Base::insert;
+
+		template<class P, std::enable_if_t<std::is_constructible_v<value_type, P>, int> = 0>
+		std::pair<iterator, bool> insert(P&& value) {
+			return this->emplace(std::forward<P>(value));
+		}
+
+		template<class P, std::enable_if_t<std::is_constructible_v<value_type, P>, int> = 0>
+		iterator insert(const_iterator hint, P&& value) {
+			return this->emplaceHint(hint, std::forward<P>(value));
+		}
+
+		template<class... Args>
+		std::pair<iterator, bool> tryEmplace(const key_type& key, Args&&... args) {
+			std::pair<Location, bool> result = tryEmplace_(this->tree_value.findPlace(key), key, std::forward<Args>(args)...);
+			return { iterator(&(this->tree_value), result.first), result.second };
+		}
+
+		template<class... Args>
+		std::pair<iterator, bool> tryEmplace(key_type&& key, Args&&... args) {
+			std::pair<Location, bool> result = tryEmplace_(this->tree_value.findPlace(key), std::move(key), std::forward<Args>(args)...);
+			return { iterator(&(this->tree_value), result.first), result.second };
+		}
+
+		template<class... Args>
+		iterator tryEmplace(const_iterator hint, const key_type& key, Args&&... args) {
+			assert(hint.getContainer() == &(this->tree_value) && "Iterator from another container");
+			return iterator(&(this->tree_value), tryEmplace_(this->tree_value.findPlaceWithHint(hint.location(), key), key, std::forward<Args>(args)...).first);
+		}
+
+		template<class... Args>
+		iterator tryEmplace(const_iterator hint, key_type&& key, Args&&... args) {
+			assert(hint.getContainer() == &(this->tree_value) && "Iterator from another container");
+			return iterator(&(this->tree_value), tryEmplace_(this->tree_value.findPlaceWithHint(hint.location(), key), std::move(key), std::forward<Args>(args)...).first);
+		}
+
+		template<class M>
+		std::pair<iterator, bool> insertOrAssign(const key_type& key, M&& obj) {
+			std::pair<Location, bool> result = insertOrAssign_(this->tree_value.findPlace(key), key, std::forward<M>(obj));
+			return { iterator(&(this->tree_value), result.first), result.second };
+		}
+
+		template<class M>
+		std::pair<iterator, bool> insertOrAssign(key_type&& key, M&& obj) {
+			std::pair<Location, bool> result = insertOrAssign_(this->tree_value.findPlace(key), std::move(key), std::forward<M>(obj));
+			return { iterator(&(this->tree_value), result.first), result.second };
+		}
+
+		T& operator[](const key_type& key) {
+			Location location = tryEmplace_(this->tree_value.findPlace(key), key).first;
+			return location.node->slot(location.position)->second;
+		}
+
+		T& operator[](key_type&& key) {
+			Location location = tryEmplace_(this->tree_value.findPlace(key), std::move(key)).first;
+			return location.node->slot(location.position)->second;
+		}
+
+		[[nodiscard]] T& at(const key_type& key) {
+			BTreeFindResult<Node> result = this->tree_value.findPlace(key);
+			if (!result.duplicate) throw std::out_of_range("Invalid key");
+			return result.location.node->slot(result.location.position)->second;
+		}
+
+		[[nodiscard]] const T& at(const key_type& key) const {
+			BTreeFindResult<Node> result = this->tree_value.findPlace(key);
+			if (!result.duplicate) throw std::out_of_range("Invalid key");
+			return result.location.node->slot(result.location.position)->second;
+		}
+
+	protected:
+		template<class K, class... Args>
+		std::pair<Location, bool> tryEmplace_(BTreeFindResult<Node> result, K&& key, Args&&... args) {
+			if (result.duplicate) return { result.location, false };
+			this->checkGrow();
+			return { this->tree_value.insertValue(result.location, std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+				std::forward_as_tuple(std::forward<Args>(args)...)), true };
+		}
+
+		template<class K, class M>
+		std::pair<Location, bool> insertOrAssign_(BTreeFindResult<Node> result, K&& key, M&& obj) {
+			if (result.duplicate) {
+				result.location.node->slot(result.location.position)->second = std::forward<M>(obj);
+				return { result.location, false };
+			}
+			this->checkGrow();
+			return { this->tree_value.insertValue(result.location, std::forward<K>(key), std::forward<M>(obj)), true };
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,337 @@
+#pragma once
+#include <vector>
+#include <iterator>
+#include <functional>
+#include "Map.h"
+
+namespace mylib {
+	struct BufferedMapOp { // a staged value either replaces the one in the tree or is only inserted if the key is absent there
+		struct NodeData {
+			bool assigned;
+		};
+
+		template<class NodePtr>
+		static void update(NodePtr) noexcept {}
+
+		static constexpr bool updates_to_root = false;
+	};
+
+	// Walks the tree and the staging area of a BufferedMap side by side in key order. For a key in both, an assigned
+	// staged value hides the one in the tree and one staged by tryEmplace is hidden by it, and erased keys are skipped.
+	template<class BufferedMap>
+	class BufferedMapConstIterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type		= typename BufferedMap::value_type;
+		using difference_type	= typename BufferedMap::difference_type;
+		using reference			= const value_type&;
+		using pointer			= const value_type*;
+
+		using key_type			= typename BufferedMap::key_type;
+		using key_compare		= typename BufferedMap::key_compare;
+		using TreeIterator		= typename BufferedMap::Main::const_iterator;
+		using StagedIterator	= typename BufferedMap::Staging::const_iterator;
+
+		BufferedMapConstIterator(const key_compare* comp, TreeIterator tree_it, StagedIterator staged_it, const key_type* erased_it, const key_type* erased_end)
+				: comp{ comp }, tree_it{ tree_it }, staged_it{ staged_it }, erased_it{ erased_it }, erased_end{ erased_end }, from_staged{} {
+			settle();
+		}
+
+		[[nodiscard]] reference operator*() const noexcept {
+			return from_staged ? staged_it.ptr->value : tree_it.ptr->value;
+		}
+
+		[[nodiscard]] pointer operator->() const noexcept {
+			return std::addressof(**this);
+		}
+
+		BufferedMapConstIterator& operator++() noexcept {
+			assert(!atEnd() && "Iterator out of range");
+			if (from_staged) ++staged_it;
+			else ++tree_it;
+			settle();
+			return *this;
+		}
+
+		BufferedMapConstIterator operator++(int) noexcept {
+			BufferedMapConstIterator tmp = *this;
+			++*this;
+			return tmp;
+		}
+
+		[[nodiscard]] bool operator==(const BufferedMapConstIterator& rhs) const noexcept {
+			return tree_it.ptr == rhs.tree_it.ptr && staged_it.ptr == rhs.staged_it.ptr;
+		}
+
+		[[nodiscard]] bool operator!=(const BufferedMapConstIterator& rhs) const noexcept {
+			return !(*this == rhs);
+		}
+
+	private:
+		[[nodiscard]] bool atEnd() const noexcept {
+			return tree_it.ptr->is_nil && staged_it.ptr->is_nil;
+		}
+
+		void settle() noexcept {
+			while (true) {
+				if (!tree_it.ptr->is_nil) {
+					const key_type& key = tree_it.ptr->value.first;
+					while (erased_it != erased_end && (*comp)(*erased_it, key)) ++erased_it;
+					if (erased_it != erased_end && !(*comp)(key, *erased_it)) {
+						++tree_it;
+						continue;
+					}
+				}
+
+				if (staged_it.ptr->is_nil || tree_it.ptr->is_nil) {
+					from_staged = !staged_it.ptr->is_nil;
+					return;
+				}
+
+				const key_type& tree_key	= tree_it.ptr->value.first;
+				const key_type& staged_key	= staged_it.ptr->value.first;
+				if ((*comp)(staged_key, tree_key)) from_staged = true;
+				else if ((*comp)(tree_key, staged_key)) from_staged = false;
+				else if (staged_it.ptr->assigned) {
+					++tree_it;
+					continue;
+				}
+				else {
+					++staged_it;
+					continue;
+				}
+				return;
+			}
+		}
+
+		const key_compare* comp;
+		TreeIterator tree_it;
+		StagedIterator staged_it;
+		const key_type* erased_it;
+		const key_type* erased_end;
+		bool from_staged;
+
+		friend BufferedMap;
+	};
+
+	// A Map for write-heavy use. Insertions and erasures go to a small staging area, a Map of their own plus a sorted
+	// vector of erased keys, without looking at the main tree, and once buffer_capacity of them have piled up they are
+	// applied to it in key order. Lookups and iteration merge both on the fly, so they cost a little more. The
+	// writes return nothing, as whether a key is present is only known after the flush, and size() flushes first.
+	// Any write may flush and so invalidates all iterators.
+	template<class Key, class T, class Compare = std::less<Key>, class Allocator = std::allocator<std::pair<const Key, T>>>
+	class BufferedMap {
+	public:
+		using Main				= Map<Key, T, Compare, Allocator>;
+		using Staging			= Map<Key, T, Compare, Allocator, BufferedMapOp>;
+		using allocator_type	= typename Main::allocator_type;
+		using key_type			= typename Main::key_type;
+		using mapped_type		= T;
+		using value_type		= typename Main::value_type;
+		using key_compare		= typename Main::key_compare;
+		using size_type			= typename Main::size_type;
+		using difference_type	= typename Main::difference_type;
+		using const_reference	= const value_type&;
+		using const_iterator	= BufferedMapConstIterator<BufferedMap>;
+
+	protected:
+		using ErasedAlloc		= typename std::allocator_traits<Allocator>::template rebind_alloc<Key>;
+
+	public:
+		static constexpr size_type default_buffer_capacity	= 1024;
+		static constexpr size_type flush_group				= 256;
+
+		BufferedMap() : BufferedMap(default_buffer_capacity) {}
+
+		explicit BufferedMap(size_type buffer_capacity, const Compare& comp = Compare(), const Allocator& alloc = Allocator())
+				: tree{ comp, alloc }, staged{ comp, alloc }, erased{ ErasedAlloc(alloc) }, comp{ comp }, buffer_capacity{ buffer_capacity } {
+			assert(buffer_capacity != 0 && "Buffer capacity has to be positive");
+		}
+
+		BufferedMap(const BufferedMap&) = default;
+		BufferedMap(BufferedMap&&) = default;
+		BufferedMap& operator=(const BufferedMap&) = default;
+		BufferedMap& operator=(BufferedMap&&) = default;
+
+		template<class... Args>
+		void tryEmplace(const key_type& key, Args&&... args) {
+			tryEmplace_(key, std::forward<Args>(args)...);
+		}
+
+		template<class... Args>
+		void tryEmplace(key_type&& key, Args&&... args) {
+			tryEmplace_(std::move(key), std::forward<Args>(args)...);
+		}
+
+		void insert(const value_type& value) {
+			tryEmplace_(value.first, value.second);
+		}
+
+		void insert(std::initializer_list<value_type> init) {
+			for (const value_type& value : init) tryEmplace_(value.first, value.second);
+		}
+
+		template<class M>
+		void insertOrAssign(const key_type& key, M&& obj) {
+			insertOrAssign_(key, std::forward<M>(obj));
+		}
+
+		template<class M>
+		void insertOrAssign(key_type&& key, M&& obj) {
+			insertOrAssign_(std::move(key), std::forward<M>(obj));
+		}
+
+		void erase(const key_type& key) {
+			if (staged.erase(key)) --staged_count;
+			const auto place = std::lower_bound(erased.begin(), erased.end(), key, comp);
+			if (place == erased.end() || comp(key, *place)) erased.insert(place, key);
+			flushIfFull();
+		}
+
+		// Applies the staged writes to the main tree in key order, flush_group keys at a time. Every group is looked up
+		// with findMany first, whose interleaved descents bring the paths into the cache for the writes that follow, and
+		// a staged value whose key is found is assigned or dropped on the spot. The writes are unstaged only once applied,
+		// so should an insertion throw, the ones not yet applied stay buffered.
+		void flush() {
+			std::vector<value_type*> found(flush_group);
+			for (auto first = erased.begin(); first != erased.end(); ) {
+				const auto last = static_cast<size_type>(erased.end() - first) > flush_group ? first + flush_group : erased.end();
+				tree.findMany(first, last, found.begin());
+				for (; first != last; ++first) tree.erase(*first);
+			}
+			erased.clear();
+
+			std::vector<std::reference_wrapper<const Key>> keys;
+			keys.reserve(flush_group);
+			for (auto it = staged.begin(); it != staged.end(); ) {
+				keys.clear();
+				for (auto ahead = it; ahead != staged.end() && keys.size() != flush_group; ++ahead) keys.push_back(std::cref(ahead->first));
+				tree.findMany(keys.begin(), keys.end(), found.begin());
+
+				const auto group = it;
+				size_type applied = 0;
+				try {
+					for (; applied != keys.size(); ++applied, ++it) {
+						if (!found[applied]) tree.tryEmplace(it->first, std::move(it->second)); // throws
+						else if (it.ptr->assigned) found[applied]->second = std::move(it->second);
+					}
+				}
+				catch (...) {
+					staged.erase(group, it);
+					staged_count -= applied;
+					throw;
+				}
+
+				it = staged.erase(group, it);
+				staged_count -= applied;
+			}
+		}
+
+		void clear() {
+			tree.clear();
+			staged.clear();
+			erased.clear();
+			staged_count = 0;
+		}
+
+		[[nodiscard]] const_iterator find(const key_type& key) const {
+			const_iterator it = lowerBound(key);
+			return !it.atEnd() && !comp(key, it->first) ? it : end();
+		}
+
+		[[nodiscard]] bool contains(const key_type& key) const {
+			if (staged.contains(key)) return true;
+			return !std::binary_search(erased.begin(), erased.end(), key, comp) && tree.contains(key);
+		}
+
+		[[nodiscard]] const_iterator lowerBound(const key_type& key) const {
+			return const_iterator(&comp, tree.lowerBound(key), staged.lowerBound(key),
+				erased.data() + (std::lower_bound(erased.begin(), erased.end(), key, comp) - erased.begin()), erased.data() + erased.size());
+		}
+
+		[[nodiscard]] const_iterator upperBound(const key_type& key) const {
+			return const_iterator(&comp, tree.upperBound(key), staged.upperBound(key),
+				erased.data() + (std::upper_bound(erased.begin(), erased.end(), key, comp) - erased.begin()), erased.data() + erased.size());
+		}
+
+		[[nodiscard]] const_iterator begin() const {
+			return const_iterator(&comp, tree.cbegin(), staged.cbegin(), erased.data(), erased.data() + erased.size());
+		}
+
+		[[nodiscard]] const_iterator end() const {
+			return const_iterator(&comp, tree.cend(), staged.cend(), erased.data() + erased.size(), erased.data() + erased.size());
+		}
+
+		[[nodiscard]] const_iterator cbegin() const {
+			return begin();
+		}
+
+		[[nodiscard]] const_iterator cend() const {
+			return end();
+		}
+
+		[[nodiscard]] size_type size() {
+			flush();
+			return tree.size();
+		}
+
+		[[nodiscard]] bool empty() const {
+			return begin() == end();
+		}
+
+		[[nodiscard]] size_type bufferedCount() const noexcept { // writes waiting for the next flush
+			return staged_count + erased.size();
+		}
+
+		[[nodiscard]] allocator_type getAllocator() const {
+			return tree.getAllocator();
+		}
+
+		[[nodiscard]] key_compare keyComp() const {
+			return comp;
+		}
+
+	protected:
+		// A key erased before is put back with assigned set, as the tree may still hold it until the flush
+		[[nodiscard]] bool unerase(const key_type& key) {
+			const auto place = std::lower_bound(erased.begin(), erased.end(), key, comp);
+			if (place == erased.end() || comp(key, *place)) return false;
+			erased.erase(place);
+			return true;
+		}
+
+		template<class K, class... Args>
+		void tryEmplace_(K&& key, Args&&... args) {
+			auto result = staged.tryEmplace(std::forward<K>(key), std::forward<Args>(args)...); // throws
+			if (result.second) {
+				result.first.ptr->assigned = unerase(result.first->first);
+				++staged_count;
+			}
+			flushIfFull();
+		}
+
+		template<class K, class M>
+		void insertOrAssign_(K&& key, M&& obj) {
+			auto result = staged.insertOrAssign(std::forward<K>(key), std::forward<M>(obj)); // throws
+			result.first.ptr->assigned = true;
+			if (result.second) {
+				(void)unerase(result.first->first); // assigned is set either way
+				++staged_count;
+			}
+			flushIfFull();
+		}
+
+		void flushIfFull() {
+			if (staged_count + erased.size() >= buffer_capacity) flush();
+		}
+
+		Main tree;
+		Staging staged;
+		std::vector<Key, ErasedAlloc> erased;
+		Compare comp;
+		size_type buffer_capacity;
+		size_type staged_count = 0;
+
+		friend class BufferedMapConstIterator<BufferedMap>;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,429 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <optional>
+#include <thread>
+#include "Tree.h"
+
+namespace mylib {
+	// The links of a node follow it in the same allocation, one per level. The lowest bit of a link marks the node as
+	// erased on that level, so that no node can be linked after it there any more.
+	template<class ValueType>
+	struct alignas(std::atomic<std::uintptr_t>) ConcurrentMapNode {
+		using Link = std::atomic<std::uintptr_t>;
+
+		static constexpr unsigned char linked = 1; // the inserting thread is done linking the node
+		static constexpr unsigned char erased = 2; // the erasing thread is done marking the node
+
+		[[nodiscard]] Link& next(std::size_t level) noexcept {
+			return reinterpret_cast<Link*>(this + 1)[level];
+		}
+
+		[[nodiscard]] static std::size_t units(std::size_t height) noexcept { // in sizeof(ConcurrentMapNode)
+			return 1 + (height * sizeof(Link) + sizeof(ConcurrentMapNode) - 1) / sizeof(ConcurrentMapNode);
+		}
+
+		ConcurrentMapNode* retired_next;
+		std::atomic<unsigned char> state;
+		unsigned char height;
+		ValueType value;
+	};
+
+	// A thread holds a slot for the length of one operation. The nodes it retires wait in the slot until every
+	// operation that could still see them has ended, that is until the global epoch has moved on by two.
+	template<class Node>
+	struct alignas(64) ConcurrentMapEpochSlot {
+		std::atomic<std::uint64_t> state; // zero if free, the epoch shifted left by one with the lowest bit set otherwise
+		std::array<Node*, 3> retired;
+		std::array<std::uint64_t, 3> retired_epoch;
+		std::size_t retired_count;
+	};
+
+	// A lock-free ordered map for many threads: a skip list whose links are changed only by compare-and-swap, with
+	// erased nodes freed by epoch-based reclamation. Values cannot be changed once inserted, and lookups return copies,
+	// as a node may be freed once the lookup ends. Iteration is weakly consistent: it sees every value present for its
+	// whole duration and may or may not see the ones inserted or erased meanwhile. size is exact only when quiescent.
+	// Every thread allocates and frees nodes through its own copy of the allocator, so the map only reads the one it
+	// keeps, and the copies have to be usable at once from many threads, as std::allocator and allocators over a
+	// synchronized memory resource are.
+	template<class Key, class T, class Compare = std::less<Key>, class Allocator = std::allocator<std::pair<const Key, T>>>
+	class ConcurrentMap {
+	protected:
+		using Traits			= MapTraits<Key, T, Compare, Allocator>;
+
+	public:
+		using allocator_type	= typename Traits::allocator_type;
+		using key_type			= typename Traits::key_type;
+		using mapped_type		= T;
+		using value_type		= typename Traits::value_type;
+		using key_compare		= typename Traits::key_compare;
+
+	protected:
+		using Node				= ConcurrentMapNode<value_type>;
+		using Slot				= ConcurrentMapEpochSlot<Node>;
+		using Alloc				= typename std::allocator_traits<allocator_type>::template rebind_alloc<Node>;
+		using AllocTraits		= std::allocator_traits<Alloc>;
+
+		static_assert(std::is_same_v<typename AllocTraits::pointer, Node*>, "Links are tagged, so the allocator has to return plain pointers");
+
+		static constexpr std::size_t max_level		= 32;
+		static constexpr std::size_t slot_count		= 64;
+		static constexpr std::size_t advance_period = 64; // retirements between attempts to move the epoch on
+		static constexpr std::uintptr_t mark		= 1;
+
+	public:
+		using size_type			= typename AllocTraits::size_type;
+		using difference_type	= typename AllocTraits::difference_type;
+		using reference			= value_type&;
+		using const_reference	= const value_type&;
+
+		ConcurrentMap() : ConcurrentMap(Compare{}, Allocator{}) {}
+
+		explicit ConcurrentMap(const Compare& comp, const Allocator& alloc = Allocator()) : comp{ comp }, alloc{ alloc }, head{}, size_{}, epoch{ 1 }, slots{} {
+			head = this->alloc.allocate(Node::units(max_level)); // the head is a tower of links without a value
+			head->height = max_level;
+			for (std::size_t level = 0; level < max_level; ++level) ::new(std::addressof(head->next(level))) typename Node::Link(0);
+		}
+
+		explicit ConcurrentMap(const Allocator& alloc) : ConcurrentMap(Compare{}, alloc) {}
+
+		ConcurrentMap(const ConcurrentMap&) = delete;
+		ConcurrentMap& operator=(const ConcurrentMap&) = delete;
+
+		~ConcurrentMap() {
+			Node* node = pointerOf(head->next(0).load(std::memory_order_relaxed));
+			while (node) {
+				Node* next = pointerOf(node->next(0).load(std::memory_order_relaxed));
+				freeNode(node);
+				node = next;
+			}
+			for (Slot& slot : slots) {
+				for (Node*& retired : slot.retired) freeRetired(std::exchange(retired, nullptr));
+			}
+			alloc.deallocate(head, Node::units(max_level));
+		}
+
+		bool insert(const value_type& value) {
+			return emplace(value);
+		}
+
+		bool insert(value_type&& value) {
+			return emplace(std::move(value));
+		}
+
+		template<class... Args>
+		bool emplace(Args&&... args) {
+			Node* node = createNode(std::forward<Args>(args)...); // throws
+			EpochGuard guard(*this);
+			if (insertNode(guard, node)) return true;
+			freeNode(node);
+			return false;
+		}
+
+		template<class... Args>
+		bool tryEmplace(const key_type& key, Args&&... args) {
+			{
+				EpochGuard guard(*this);
+				if (findNode(key)) return false;
+			}
+			Node* node = createNode(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...)); // throws
+			EpochGuard guard(*this);
+			if (insertNode(guard, node)) return true;
+			freeNode(node);
+			return false;
+		}
+
+		size_type erase(const key_type& key) {
+			EpochGuard guard(*this);
+			std::array<Node*, max_level> preds, succs;
+			if (!findNeighbours(key, preds, succs)) return 0;
+
+			Node* node = succs[0];
+			for (std::size_t level = node->height; level-- > 1;) {
+				std::uintptr_t next = node->next(level).load(std::memory_order_acquire);
+				while (!(next & mark) && !node->next(level).compare_exchange_weak(next, next | mark, std::memory_order_acq_rel)) {}
+			}
+
+			std::uintptr_t next = node->next(0).load(std::memory_order_acquire);
+			while (true) { // marking the lowest level erases the value, and only one thread gets to do it
+				if (next & mark) return 0;
+				if (node->next(0).compare_exchange_weak(next, next | mark, std::memory_order_acq_rel)) break;
+			}
+			size_.fetch_sub(1, std::memory_order_relaxed);
+
+			if (node->state.fetch_or(Node::erased, std::memory_order_acq_rel) & Node::linked) {
+				findNeighbours(key, preds, succs); // unlinks the node from every level
+				retire(guard, node);
+			}
+			return 1;
+		}
+
+		[[nodiscard]] bool contains(const key_type& key) const {
+			EpochGuard guard(*this);
+			return findNode(key) != nullptr;
+		}
+
+		[[nodiscard]] std::optional<mapped_type> find(const key_type& key) const {
+			EpochGuard guard(*this);
+			const Node* node = findNode(key);
+			if (!node) return std::nullopt;
+			return node->value.second;
+		}
+
+		[[nodiscard]] std::optional<value_type> lowerBound(const key_type& key) const {
+			EpochGuard guard(*this);
+			const Node* node = lowerBoundNode(key);
+			if (!node) return std::nullopt;
+			return node->value;
+		}
+
+		template<class Fn>
+		void forEach(Fn fn) const {
+			EpochGuard guard(*this);
+			forEachFrom(pointerOf(head->next(0).load(std::memory_order_acquire)), [](const Node*) { return true; }, fn);
+		}
+
+		template<class Fn>
+		void forEachInRange(const key_type& first_key, const key_type& last_key, Fn fn) const { // over the keys in [first_key, last_key)
+			EpochGuard guard(*this);
+			forEachFrom(lowerBoundNode(first_key), [&](const Node* node) { return comp(Traits::getKeyFromValue(node->value), last_key); }, fn);
+		}
+
+		[[nodiscard]] size_type size() const noexcept {
+			return size_.load(std::memory_order_relaxed);
+		}
+
+		[[nodiscard]] bool empty() const noexcept {
+			return !size();
+		}
+
+		[[nodiscard]] allocator_type getAllocator() const noexcept {
+			return static_cast<allocator_type>(alloc);
+		}
+
+		[[nodiscard]] key_compare keyComp() const {
+			return comp;
+		}
+
+	protected:
+		// Pins the epoch for the length of an operation, so that no node the operation may still reach is freed.
+		class EpochGuard {
+		public:
+			explicit EpochGuard(const ConcurrentMap& map) : map{ map } {
+				const std::size_t hint = threadHint();
+				for (std::size_t i = hint;; ++i) {
+					if (i != hint && (i - hint) % slot_count == 0) std::this_thread::yield(); // every slot is taken
+
+					Slot& candidate = this->map.slots[i % slot_count];
+					std::uint64_t expected = 0;
+					current = this->map.epoch.load(std::memory_order_seq_cst);
+					if (candidate.state.compare_exchange_strong(expected, current << 1 | 1, std::memory_order_seq_cst)) {
+						slot = &candidate;
+						break;
+					}
+				}
+				this->map.reclaim(*slot, current);
+			}
+
+			EpochGuard(const EpochGuard&) = delete;
+			EpochGuard& operator=(const EpochGuard&) = delete;
+
+			~EpochGuard() {
+				slot->state.store(0, std::memory_order_release);
+			}
+
+			const ConcurrentMap& map;
+			Slot* slot;
+			std::uint64_t current;
+		};
+
+		[[nodiscard]] static std::size_t threadHint() noexcept {
+			static std::atomic<std::size_t> next_hint{ 0 };
+			thread_local const std::size_t hint = next_hint.fetch_add(1, std::memory_order_relaxed);
+			return hint;
+		}
+
+		[[nodiscard]] static std::size_t randomHeight() noexcept { // one more level with probability 1/2
+			thread_local std::uint64_t random = threadHint() * 0x9E3779B97F4A7C15ull + 0x2545F4914F6CDD1Dull;
+			random ^= random << 13;
+			random ^= random >> 7;
+			random ^= random << 17;
+
+			std::size_t height = 1;
+			for (std::uint64_t bits = random; (bits & 1) && height < max_level; bits >>= 1) ++height;
+			return height;
+		}
+
+		[[nodiscard]] static Node* pointerOf(std::uintptr_t link) noexcept {
+			return reinterpret_cast<Node*>(link & ~mark);
+		}
+
+		[[nodiscard]] static std::uintptr_t linkOf(Node* node) noexcept {
+			return reinterpret_cast<std::uintptr_t>(node);
+		}
+
+		template<class... Args>
+		[[nodiscard]] Node* createNode(Args&&... args) {
+			const std::size_t height = randomHeight();
+			Alloc node_alloc(alloc);
+			Node* node = node_alloc.allocate(Node::units(height));
+			try {
+				construct(node_alloc, std::addressof(node->value), std::forward<Args>(args)...);
+			}
+			catch (...) {
+				node_alloc.deallocate(node, Node::units(height));
+				throw;
+			}
+			node->retired_next = nullptr;
+			::new(std::addressof(node->state)) std::atomic<unsigned char>(0);
+			node->height = static_cast<unsigned char>(height);
+			for (std::size_t level = 0; level < height; ++level) ::new(std::addressof(node->next(level))) typename Node::Link(0);
+			return node;
+		}
+
+		void freeNode(Node* node) const noexcept {
+			Alloc node_alloc(alloc);
+			destroy(node_alloc, std::addressof(node->value));
+			node_alloc.deallocate(node, Node::units(node->height));
+		}
+
+		void freeRetired(Node* node) const noexcept {
+			while (node) freeNode(std::exchange(node, node->retired_next));
+		}
+
+		// The node is labelled with the global epoch rather than the one pinned, which may be a step behind: a thread that
+		// pinned the global epoch before the node was unlinked may still be reading it.
+		void retire(EpochGuard& guard, Node* node) noexcept {
+			Slot& slot = *guard.slot;
+			const std::uint64_t current = epoch.load(std::memory_order_seq_cst);
+			const std::size_t index = current % 3;
+			node->retired_next			= slot.retired[index];
+			slot.retired[index]			= node;
+			slot.retired_epoch[index]	= current;
+			if (++slot.retired_count % advance_period == 0) tryAdvance(current);
+		}
+
+		void reclaim(Slot& slot, std::uint64_t current) const noexcept { // frees what was retired two epochs ago or earlier
+			for (std::size_t index = 0; index < 3; ++index) {
+				if (slot.retired[index] && slot.retired_epoch[index] + 2 <= current) freeRetired(std::exchange(slot.retired[index], nullptr));
+			}
+		}
+
+		void tryAdvance(std::uint64_t current) noexcept {
+			for (const Slot& slot : slots) {
+				const std::uint64_t state = slot.state.load(std::memory_order_seq_cst);
+				if ((state & 1) && (state >> 1) != current) return;
+			}
+			epoch.compare_exchange_strong(current, current + 1, std::memory_order_seq_cst);
+		}
+
+		// Fills preds and succs with the neighbours of key on every level and unlinks the erased nodes met on the way.
+		// Returns false if another thread changed a link first, so that the search has to start over.
+		template<class K>
+		[[nodiscard]] bool tryFindNeighbours(const K& key, std::array<Node*, max_level>& preds, std::array<Node*, max_level>& succs) noexcept {
+			Node* pred = head;
+			for (std::size_t level = max_level; level-- > 0;) {
+				Node* curr = pointerOf(pred->next(level).load(std::memory_order_acquire));
+				while (curr) {
+					const std::uintptr_t next = curr->next(level).load(std::memory_order_acquire);
+					if (next & mark) {
+						std::uintptr_t expected = linkOf(curr);
+						if (!pred->next(level).compare_exchange_strong(expected, next & ~mark, std::memory_order_acq_rel)) return false;
+						curr = pointerOf(next);
+						continue;
+					}
+					if (!comp(Traits::getKeyFromValue(curr->value), key)) break;
+					pred = curr;
+					curr = pointerOf(next);
+				}
+				preds[level] = pred;
+				succs[level] = curr;
+			}
+			return true;
+		}
+
+		template<class K>
+		bool findNeighbours(const K& key, std::array<Node*, max_level>& preds, std::array<Node*, max_level>& succs) noexcept {
+			while (!tryFindNeighbours(key, preds, succs)) {}
+			return succs[0] && !comp(key, Traits::getKeyFromValue(succs[0]->value));
+		}
+
+		bool insertNode(EpochGuard& guard, Node* node) noexcept {
+			const key_type& key = Traits::getKeyFromValue(node->value);
+			std::array<Node*, max_level> preds, succs;
+			while (true) {
+				if (findNeighbours(key, preds, succs)) return false;
+
+				for (std::size_t level = 0; level < node->height; ++level) node->next(level).store(linkOf(succs[level]), std::memory_order_relaxed);
+				std::uintptr_t expected = linkOf(succs[0]);
+				if (preds[0]->next(0).compare_exchange_strong(expected, linkOf(node), std::memory_order_acq_rel)) break;
+			}
+			size_.fetch_add(1, std::memory_order_relaxed);
+
+			for (std::size_t level = 1; level < node->height; ++level) {
+				if (!linkLevel(node, level, preds, succs)) break;
+			}
+
+			// Whichever of the inserting and erasing threads finishes last unlinks the node and retires it, as the
+			// inserting one may link a level after the erasing one has searched it.
+			if (node->state.fetch_or(Node::linked, std::memory_order_acq_rel) & Node::erased) {
+				findNeighbours(key, preds, succs);
+				retire(guard, node);
+			}
+			return true;
+		}
+
+		bool linkLevel(Node* node, std::size_t level, std::array<Node*, max_level>& preds, std::array<Node*, max_level>& succs) noexcept {
+			while (true) {
+				std::uintptr_t next = node->next(level).load(std::memory_order_acquire);
+				if (next & mark) return false;
+				if (pointerOf(next) != succs[level] && !node->next(level).compare_exchange_strong(next, linkOf(succs[level]), std::memory_order_acq_rel)) continue;
+
+				std::uintptr_t expected = linkOf(succs[level]);
+				if (preds[level]->next(level).compare_exchange_strong(expected, linkOf(node), std::memory_order_acq_rel)) return true;
+				findNeighbours(Traits::getKeyFromValue(node->value), preds, succs);
+				if (succs[0] != node) return false; // erased and unlinked meanwhile
+			}
+		}
+
+		template<class K>
+		[[nodiscard]] Node* lowerBoundNode(const K& key) const noexcept {
+			Node* pred = head;
+			Node* curr = nullptr;
+			for (std::size_t level = max_level; level-- > 0;) {
+				curr = pointerOf(pred->next(level).load(std::memory_order_acquire));
+				while (curr) {
+					const std::uintptr_t next = curr->next(level).load(std::memory_order_acquire);
+					if (!(next & mark)) {
+						if (!comp(Traits::getKeyFromValue(curr->value), key)) break;
+						pred = curr;
+					}
+					curr = pointerOf(next);
+				}
+			}
+			return curr;
+		}
+
+		template<class K>
+		[[nodiscard]] Node* findNode(const K& key) const noexcept {
+			Node* node = lowerBoundNode(key);
+			return node && !comp(key, Traits::getKeyFromValue(node->value)) ? node : nullptr;
+		}
+
+		template<class Predicate, class Fn>
+		void forEachFrom(Node* node, Predicate in_range, Fn& fn) const {
+			while (node && in_range(node)) {
+				const std::uintptr_t next = node->next(0).load(std::memory_order_acquire);
+				if (!(next & mark)) fn(static_cast<const value_type&>(node->value));
+				node = pointerOf(next);
+			}
+		}
+
+		key_compare comp;
+		Alloc alloc; // only copied while the map is in use, as any thread may allocate or free a node
+		Node* head;
+		std::atomic<size_type> size_;
+		std::atomic<std::uint64_t> epoch;
+		mutable std::array<Slot, slot_count> slots;
+	};
+}
\ No newline at end of file
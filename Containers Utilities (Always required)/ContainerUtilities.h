@@ -1,7 +1,15 @@
 #pragma once
 #include <memory>
 #include <algorithm>
+#include <utility>
+#include <tuple>
+#include <string>
+#include <string_view>
 #include <cassert>
+#include <cstdint>
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#endif
 
 namespace mylib {
 	template<class Alloc, class T, class... Args>
@@ -24,6 +32,33 @@ namespace mylib {
 		return ptr;
 	}
 
+	// Starts loading the cache line at ptr, so that a dependent load issued later does not stall on it
+	template<class Ptr>
+	void prefetchForRead(Ptr ptr) noexcept {
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+		_mm_prefetch(reinterpret_cast<const char*>(unfancy(ptr)), _MM_HINT_T0);
+#elif defined(__GNUC__)
+		__builtin_prefetch(unfancy(ptr), 0, 3);
+#else
+		(void)ptr;
+#endif
+	}
+
+	// Counts the zero bits below the lowest set one; bits may not be zero
+	[[nodiscard]] inline unsigned countTrailingZeros(std::uint64_t bits) noexcept {
+#if defined(_MSC_VER) && defined(_M_X64)
+		unsigned long index;
+		_BitScanForward64(&index, bits);
+		return static_cast<unsigned>(index);
+#elif defined(__GNUC__)
+		return static_cast<unsigned>(__builtin_ctzll(bits));
+#else
+		unsigned count = 0;
+		for (; !(bits & 1); bits >>= 1) ++count;
+		return count;
+#endif
+	}
+
 	struct MoveTag {
 		explicit MoveTag() {}
 	};
@@ -42,6 +77,59 @@ namespace mylib {
 		return std::move(obj);
 	}
 
+	// A view of an emplace argument that lookups compare with string keys in place of a Key built from it. The standard
+	// makes std::less, std::equal_to and std::hash of a basic_string agree with those of its basic_string_view, so
+	// containers using them find a duplicate without allocating.
+	template<class Key, class... KeyArgs>
+	struct KeyView {
+		static const bool viewable = false;
+	};
+
+	template<class CharT, class Traits, class Alloc, class Arg>
+	struct KeyView<std::basic_string<CharT, Traits, Alloc>, Arg> {
+		using view_type = std::basic_string_view<CharT, Traits>;
+
+		static const bool viewable = std::is_convertible_v<const Arg&, view_type>;
+
+		static view_type view(const Arg& arg) {
+			return arg;
+		}
+	};
+
+	// Turns the key arguments of emplace into something a lookup can use without building a node: the argument itself
+	// when it already is a Key, a view of it when the container compares views (Views) and KeyView has one, and
+	// otherwise a temporary Key constructed from it. The container moves such a Key into the node, so it is built once.
+	template<class Key, class... KeyArgs>
+	struct KeyConverter {
+		static const bool convertible = std::is_constructible_v<Key, const KeyArgs&...>;
+
+		template<bool Views>
+		static decltype(auto) convert(const KeyArgs&... key_args) {
+			if constexpr (Views && KeyView<Key, KeyArgs...>::viewable) return KeyView<Key, KeyArgs...>::view(key_args...);
+			else return Key(key_args...);
+		}
+	};
+
+	template<class Key>
+	struct KeyConverter<Key, Key> {
+		static const bool convertible = true;
+
+		template<bool Views>
+		static const Key& convert(const Key& key) {
+			return key;
+		}
+	};
+
+	// Calls make with the arguments that build the value. A Key the lookup had to build (an rvalue Key in key) is moved
+	// into the place of the key arguments through KeyExtractor::replaceKey.
+	template<class KeyExtractor, class LookupKey, class Make, class... Args>
+	decltype(auto) makeWithLookupKey(LookupKey&& key, Make&& make, Args&&... args) {
+		if constexpr (std::is_same_v<LookupKey, typename KeyExtractor::key_type>) {
+			return std::apply(std::forward<Make>(make), KeyExtractor::replaceKey(std::move(key), std::forward<Args>(args)...));
+		}
+		else return std::forward<Make>(make)(std::forward<Args>(args)...);
+	}
+
 	class ContainerBase;
 	class IteratorBase;
 	struct IteratorProxy {
@@ -0,0 +1,121 @@
+#pragma once
+#include <thread>
+#include <vector>
+#include <exception>
+#include <algorithm>
+
+namespace mylib {
+	class ThreadJoiner {
+	public:
+		ThreadJoiner(std::vector<std::thread>& threads) : threads{ threads } {}
+
+		ThreadJoiner(const ThreadJoiner&) = delete;
+		ThreadJoiner& operator=(const ThreadJoiner&) = delete;
+
+		~ThreadJoiner() {
+			for (std::thread& thread : threads) {
+				if (thread.joinable()) thread.join();
+			}
+		}
+
+	private:
+		std::vector<std::thread>& threads;
+	};
+
+	// Splits [0, count) into thread_count contiguous chunks and calls fn(first, last) for each of them,
+	// the last chunk on the calling thread. The first exception thrown by any chunk is rethrown after all of them finish.
+	template<class Fn>
+	void parallelFor(std::size_t count, unsigned thread_count, Fn&& fn) {
+		if (thread_count > count) thread_count = static_cast<unsigned>(count);
+		if (thread_count <= 1) {
+			fn(std::size_t{ 0 }, count);
+			return;
+		}
+
+		std::vector<std::exception_ptr> errors(thread_count);
+		std::vector<std::thread> threads;
+		threads.reserve(thread_count - 1);
+
+		const std::size_t chunk = count / thread_count;
+		const std::size_t rest	= count % thread_count;
+		std::size_t first		= 0;
+
+		{
+			ThreadJoiner joiner(threads);
+
+			for (unsigned i = 0; i + 1 < thread_count; ++i) {
+				const std::size_t last = first + chunk + (i < rest ? 1 : 0);
+				threads.emplace_back([&fn, &error = errors[i], first, last]() {
+					try { fn(first, last); }
+					catch (...) { error = std::current_exception(); }
+				}); // throws
+				first = last;
+			}
+
+			try { fn(first, count); }
+			catch (...) { errors.back() = std::current_exception(); }
+		}
+
+		for (const std::exception_ptr& error : errors) {
+			if (error) std::rethrow_exception(error);
+		}
+	}
+
+	// Sorts [first, last) stably: thread_count runs of equal length are sorted at once and then merged pairwise, the
+	// merges of one round running at once as well. comp must be safe to call concurrently.
+	template<class RandomIt, class Compare>
+	void parallelStableSort(RandomIt first, RandomIt last, unsigned thread_count, Compare comp) {
+		const std::size_t count = static_cast<std::size_t>(last - first);
+		if (thread_count > count) thread_count = static_cast<unsigned>(count);
+		if (thread_count <= 1) {
+			std::stable_sort(first, last, comp);
+			return;
+		}
+
+		std::vector<std::size_t> bounds(thread_count + 1);
+		for (unsigned i = 0; i <= thread_count; ++i) {
+			bounds[i] = count / thread_count * i + std::min<std::size_t>(i, count % thread_count);
+		}
+
+		parallelFor(thread_count, thread_count, [&](std::size_t run, std::size_t runs_end) {
+			for (; run != runs_end; ++run) std::stable_sort(first + bounds[run], first + bounds[run + 1], comp);
+		});
+
+		for (std::size_t width = 1; width < thread_count; width *= 2) {
+			const std::size_t merges = (thread_count + 2 * width - 1) / (2 * width);
+			parallelFor(merges, static_cast<unsigned>(merges), [&](std::size_t merge, std::size_t merges_end) {
+				for (; merge != merges_end; ++merge) {
+					const std::size_t left = merge * 2 * width;
+					if (left + width >= thread_count) continue;
+					const std::size_t right = std::min<std::size_t>(left + 2 * width, thread_count);
+					std::inplace_merge(first + bounds[left], first + bounds[left + width], first + bounds[right], comp);
+				}
+			});
+		}
+	}
+
+	// Runs fn1 on a new thread and fn2 on the calling thread and waits for both. When no thread can be started, fn1 runs
+	// on the calling thread first. An exception thrown by fn1 is rethrown after both finish.
+	template<class Fn1, class Fn2>
+	void parallelInvoke(Fn1&& fn1, Fn2&& fn2) {
+		std::vector<std::thread> threads;
+		std::exception_ptr error;
+
+		{
+			ThreadJoiner joiner(threads);
+
+			try {
+				threads.emplace_back([&fn1, &error]() {
+					try { fn1(); }
+					catch (...) { error = std::current_exception(); }
+				});
+			}
+			catch (...) {}
+
+			if (threads.empty()) fn1();
+			fn2();
+		}
+
+		if (error) std::rethrow_exception(error);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,532 @@
+#pragma once
+#include <array>
+#include <limits>
+#include <iterator>
+#include <stdexcept>
+#include "Map.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
+
+namespace mylib {
+	// Keys in Eytzinger (breadth-first) order: the children of slot i are slots 2i and 2i + 1, so the keys of the next
+	// few levels below a slot lie side by side and are prefetched while the current one is compared.
+	struct FrozenEytzinger {};
+
+	// Integer keys in a static B+ tree whose nodes hold a cache line of keys: the bottom layer is the sorted keys
+	// themselves, and each node is searched by counting its keys below the one looked for, with SSE2 for 32-bit keys.
+	struct FrozenBTree {};
+
+	template<class MapValue>
+	class FrozenMapConstIterator;
+
+	template<class Key, class T, class Compare, class Allocator, class Layout>
+	class FrozenMapValue : public ContainerBase {
+	public:
+		using allocator_type	= Allocator;
+		using key_type			= Key;
+		using mapped_type		= T;
+		using value_type		= std::pair<const Key, T>;
+		using key_compare		= Compare;
+
+		using Alloc				= typename std::allocator_traits<allocator_type>::template rebind_alloc<value_type>;
+		using AllocTraits		= std::allocator_traits<Alloc>;
+		using KeyAlloc			= typename AllocTraits::template rebind_alloc<Key>;
+		using ValuePtr			= typename AllocTraits::pointer;
+		using KeyPtr			= typename std::allocator_traits<KeyAlloc>::pointer;
+
+		using size_type			= typename AllocTraits::size_type;
+		using difference_type	= typename AllocTraits::difference_type;
+
+		static constexpr bool btree_layout = std::is_same_v<Layout, FrozenBTree>;
+		static constexpr size_type cache_line = 64;
+
+		static_assert(btree_layout || std::is_same_v<Layout, FrozenEytzinger>, "Unknown FrozenMap layout");
+		static_assert(!btree_layout || (std::is_integral_v<Key> && (std::is_same_v<Compare, std::less<Key>> || std::is_same_v<Compare, std::less<>>
+			|| std::is_same_v<Compare, std::greater<Key>> || std::is_same_v<Compare, std::greater<>>)), "FrozenBTree needs integer keys ordered by less or greater");
+
+		[[nodiscard]] static constexpr size_type blockKeys() noexcept {
+			return sizeof(Key) < cache_line ? cache_line / sizeof(Key) : 1;
+		}
+
+		// The descendants of slot i that are log2(stride) levels below it start at slot i * stride
+		[[nodiscard]] static constexpr size_type prefetchStride() noexcept {
+			size_type stride = 4;
+			while (stride * 2 * sizeof(Key) <= cache_line) stride *= 2;
+			return stride;
+		}
+
+		static constexpr size_type block_keys = btree_layout ? blockKeys() : 1;
+		static constexpr size_type max_layers = 24; // B+ nodes have at least 9 children, and 9^21 > 2^64
+
+		template<class AnyKeyCompare, class AnyAlloc>
+		FrozenMapValue(AnyKeyCompare&& comp, AnyAlloc&& alloc) : comp{ std::forward<AnyKeyCompare>(comp) }, alloc{ std::forward<AnyAlloc>(alloc) },
+			keys{}, values{}, key_count{}, size{}, layers{}, layer_offset{} {}
+
+		// Slots index the values: Eytzinger slots run from 1 to size with 0 for the end, B+ slots are sorted positions
+		[[nodiscard]] size_type endSlot() const noexcept {
+			if constexpr (btree_layout) return size;
+			else return 0;
+		}
+
+		[[nodiscard]] size_type valueSlots() const noexcept {
+			if constexpr (btree_layout) return size;
+			else return size ? size + 1 : 0;
+		}
+
+		[[nodiscard]] size_type firstSlot() const noexcept {
+			if constexpr (btree_layout) return 0;
+			else {
+				if (!size) return 0;
+				size_type slot = 1;
+				while (2 * slot <= size) slot *= 2;
+				return slot;
+			}
+		}
+
+		[[nodiscard]] size_type lastSlot() const noexcept {
+			if constexpr (btree_layout) return size - 1;
+			else {
+				size_type slot = 1;
+				while (2 * slot + 1 <= size) slot = 2 * slot + 1;
+				return slot;
+			}
+		}
+
+		// Goes down to the leftmost slot of the right subtree, or up past the ancestors whose right subtree it leaves
+		[[nodiscard]] size_type nextSlot(size_type slot) const noexcept {
+			if constexpr (btree_layout) return slot + 1;
+			else {
+				if (2 * slot + 1 <= size) {
+					slot = 2 * slot + 1;
+					while (2 * slot <= size) slot *= 2;
+					return slot;
+				}
+				return slot >> (countTrailingZeros(~static_cast<std::uint64_t>(slot)) + 1);
+			}
+		}
+
+		[[nodiscard]] size_type prevSlot(size_type slot) const noexcept {
+			if (slot == endSlot()) return lastSlot();
+			if constexpr (btree_layout) return slot - 1;
+			else {
+				if (2 * slot <= size) {
+					slot = 2 * slot;
+					while (2 * slot + 1 <= size) slot = 2 * slot + 1;
+					return slot;
+				}
+				return slot >> (countTrailingZeros(slot) + 1);
+			}
+		}
+
+		[[nodiscard]] size_type lowerBoundSlot(const key_type& key) const noexcept {
+			if (!size) return endSlot();
+
+			const Key* const key_array = unfancy(keys);
+			if constexpr (btree_layout) {
+				size_type offset = 0; // of the node within its layer, in keys
+				for (size_type layer = layers - 1; layer; --layer) {
+					const size_type rank = rankInNode(key_array + layer_offset[layer] + offset, key);
+					offset = (offset / block_keys * (block_keys + 1) + rank) * block_keys;
+				}
+				return offset + rankInNode(key_array + offset, key);
+			}
+			else {
+				// The loop runs once per level whatever the keys are, and the comparison only picks the next slot
+				size_type slot = 1;
+				while (slot <= size) {
+					prefetchForRead(key_array + std::min(slot * prefetchStride(), size));
+					slot = 2 * slot + static_cast<size_type>(comp(key_array[slot], key));
+				}
+				// Every step to the right after the last step to the left passed a smaller key
+				return slot >> (countTrailingZeros(~static_cast<std::uint64_t>(slot)) + 1);
+			}
+		}
+
+		// Counts the keys of a B+ node that go before key. Padding keys go after any key, so a node may be full of them.
+		[[nodiscard]] size_type rankInNode(const Key* node, const key_type& key) const noexcept {
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+			if constexpr (sizeof(Key) == 4 && (std::is_same_v<Compare, std::less<Key>> || std::is_same_v<Compare, std::less<>>)) {
+				// Unsigned keys are compared as signed ones with the sign bit flipped
+				const __m128i flip = _mm_set1_epi32(std::is_signed_v<Key> ? 0 : std::numeric_limits<int>::min());
+				const __m128i needle = _mm_xor_si128(_mm_set1_epi32(static_cast<int>(key)), flip);
+				__m128i counts = _mm_setzero_si128();
+				for (size_type i = 0; i < block_keys; i += 4) {
+					const __m128i block = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(node + i)), flip);
+					counts = _mm_sub_epi32(counts, _mm_cmpgt_epi32(needle, block));
+				}
+				counts = _mm_add_epi32(counts, _mm_shuffle_epi32(counts, 0x4E));
+				counts = _mm_add_epi32(counts, _mm_shuffle_epi32(counts, 0xB1));
+				return static_cast<size_type>(_mm_cvtsi128_si32(counts));
+			}
+			else
+#endif
+			{
+				size_type rank = 0;
+				for (size_type i = 0; i < block_keys; ++i) rank += comp(node[i], key);
+				return rank;
+			}
+		}
+
+		[[nodiscard]] static Key paddingKey(const Compare& comp) noexcept {
+			return comp(std::numeric_limits<Key>::lowest(), std::numeric_limits<Key>::max()) ? std::numeric_limits<Key>::max() : std::numeric_limits<Key>::lowest();
+		}
+
+		// Counts the B+ layers and where each begins; the root layer is a single node
+		void planLayers() noexcept {
+			layers = 0;
+			size_type offset = 0;
+			size_type nodes = (size + block_keys - 1) / block_keys;
+			while (true) {
+				assert(layers < max_layers && "Too many B+ layers");
+				layer_offset[layers++] = offset;
+				offset += nodes * block_keys;
+				if (nodes == 1) break;
+				nodes = (nodes + block_keys) / (block_keys + 1);
+			}
+			key_count = offset;
+		}
+
+		// Key i of an upper node is the smallest key below its child i + 1, found at the start of that child's first
+		// bottom node
+		void fillUpperLayers() noexcept {
+			const Key padding = paddingKey(comp);
+			size_type bottom_nodes_per_child = 1;
+			for (size_type layer = 1; layer < layers; ++layer) {
+				const size_type end = layer + 1 < layers ? layer_offset[layer + 1] : key_count;
+				for (size_type i = layer_offset[layer]; i < end; ++i) {
+					const size_type index = i - layer_offset[layer];
+					const size_type child = index / block_keys * (block_keys + 1) + index % block_keys + 1;
+					const size_type first = child * bottom_nodes_per_child * block_keys;
+					keys[i] = first < size ? keys[first] : padding;
+				}
+				bottom_nodes_per_child *= block_keys + 1;
+			}
+		}
+
+		key_compare comp;
+		Alloc alloc;
+		KeyPtr keys;
+		ValuePtr values;
+		size_type key_count;
+		size_type size;
+		size_type layers;
+		std::array<size_type, max_layers> layer_offset;
+	};
+
+	template<class MapValue>
+	class FrozenMapConstIterator : public IteratorBase {
+	public:
+		using iterator_category	= std::bidirectional_iterator_tag;
+		using value_type		= typename MapValue::value_type;
+		using difference_type	= typename MapValue::difference_type;
+		using size_type			= typename MapValue::size_type;
+		using reference			= const value_type&;
+		using pointer			= const value_type*;
+
+		FrozenMapConstIterator() : slot{} {}
+
+		FrozenMapConstIterator(const MapValue* container, size_type slot) : slot{ slot } {
+			this->adopt(container);
+		}
+
+		[[nodiscard]] reference operator*() const noexcept {
+			assert(this->getContainer() && "Invalid iterator error");
+			assert(slot != map()->endSlot() && "The try of dereferencing end");
+			return map()->values[slot];
+		}
+
+		[[nodiscard]] pointer operator->() const noexcept {
+			return std::addressof(**this);
+		}
+
+		FrozenMapConstIterator& operator++() noexcept {
+			assert(this->getContainer() && "Invalid iterator error");
+			assert(slot != map()->endSlot() && "Incrementing the end error");
+			slot = map()->nextSlot(slot);
+			return *this;
+		}
+
+		FrozenMapConstIterator operator++(int) noexcept {
+			FrozenMapConstIterator tmp = *this;
+			++*this;
+			return tmp;
+		}
+
+		FrozenMapConstIterator& operator--() noexcept {
+			assert(this->getContainer() && "Invalid iterator error");
+			assert(slot != map()->firstSlot() && "Decrementing the begin error");
+			slot = map()->prevSlot(slot);
+			return *this;
+		}
+
+		FrozenMapConstIterator operator--(int) noexcept {
+			FrozenMapConstIterator tmp = *this;
+			--*this;
+			return tmp;
+		}
+
+		[[nodiscard]] bool operator==(const FrozenMapConstIterator& rhs) const noexcept {
+			if (!this->getContainer() || !rhs.getContainer()) return false;
+			return slot == rhs.slot;
+		}
+
+		[[nodiscard]] bool operator!=(const FrozenMapConstIterator& rhs) const noexcept {
+			return !(*this == rhs);
+		}
+
+		[[nodiscard]] const MapValue* map() const noexcept {
+			return static_cast<const MapValue*>(this->getContainer());
+		}
+
+		size_type slot;
+	};
+
+	// A read-only ordered map built once from a Map or a sorted range. The keys are copied into one array laid out for
+	// search (see FrozenEytzinger and FrozenBTree) and the values sit in a parallel array, so a lookup reads a few cache
+	// lines of keys instead of a chain of nodes.
+	template<class Key, class T, class Compare = std::less<Key>, class Allocator = std::allocator<std::pair<const Key, T>>, class Layout = FrozenEytzinger>
+	class FrozenMap {
+	public:
+		using allocator_type	= Allocator;
+		using key_type			= Key;
+		using mapped_type		= T;
+		using value_type		= std::pair<const Key, T>;
+		using key_compare		= Compare;
+
+	protected:
+		using MapValue			= FrozenMapValue<Key, T, Compare, Allocator, Layout>;
+		using Alloc				= typename MapValue::Alloc;
+		using AllocTraits		= typename MapValue::AllocTraits;
+		using KeyAlloc			= typename MapValue::KeyAlloc;
+
+	public:
+		using size_type			= typename MapValue::size_type;
+		using difference_type	= typename MapValue::difference_type;
+		using reference			= const value_type&;
+		using const_reference	= const value_type&;
+
+		using iterator			= FrozenMapConstIterator<MapValue>; // the map never changes, so neither do its values
+		using const_iterator	= FrozenMapConstIterator<MapValue>;
+
+		FrozenMap() : FrozenMap(Compare{}, Allocator{}) {}
+
+		explicit FrozenMap(const Compare& comp, const Allocator& alloc = Allocator()) : map_value(comp, alloc) {
+			createProxy();
+		}
+
+		template<class MapAllocator, class Augment>
+		explicit FrozenMap(const Map<Key, T, Compare, MapAllocator, Augment>& map, const Allocator& alloc = Allocator()) : FrozenMap(map.keyComp(), alloc) {
+			build(map.begin(), map.end(), map.size());
+		}
+
+		// The range has to be sorted by comp and free of equal keys
+		template<class ForwardIt>
+		FrozenMap(ForwardIt first, ForwardIt last, const Compare& comp = Compare(), const Allocator& alloc = Allocator()) : FrozenMap(comp, alloc) {
+			build(first, last, static_cast<size_type>(std::distance(first, last)));
+		}
+
+		FrozenMap(std::initializer_list<value_type> init, const Compare& comp = Compare(), const Allocator& alloc = Allocator()) : FrozenMap(init.begin(), init.end(), comp, alloc) {}
+
+		FrozenMap(const FrozenMap& other) : FrozenMap(other.map_value.comp, AllocTraits::select_on_container_copy_construction(other.map_value.alloc)) {
+			build(other.begin(), other.end(), other.size());
+		}
+
+		FrozenMap(FrozenMap&& other) : map_value(other.map_value.comp, other.map_value.alloc) {
+			createProxy();
+			swapMapValue(other);
+		}
+
+		FrozenMap& operator=(const FrozenMap& other) {
+			if (this == &other) return *this;
+
+			FrozenMap copy(other.begin(), other.end(), other.map_value.comp, static_cast<allocator_type>(map_value.alloc));
+			swap(copy);
+			return *this;
+		}
+
+		FrozenMap& operator=(FrozenMap&& other) {
+			if (this == &other) return *this;
+
+			if constexpr (!AllocTraits::propagate_on_container_move_assignment::value && !AllocTraits::is_always_equal::value) {
+				if (map_value.alloc != other.map_value.alloc) return *this = static_cast<const FrozenMap&>(other);
+			}
+			clear();
+			if constexpr (AllocTraits::propagate_on_container_move_assignment::value) {
+				deleteProxy();
+				map_value.alloc = other.map_value.alloc;
+				createProxy();
+			}
+			swapMapValue(other);
+			return *this;
+		}
+
+		~FrozenMap() {
+			clear();
+			deleteProxy();
+		}
+
+		void swap(FrozenMap& other) {
+			if (this == &other) return;
+			std::swap(map_value.alloc, other.map_value.alloc);
+			swapMapValue(other);
+		}
+
+		void clear() noexcept {
+			map_value.orphanAll();
+			if (map_value.size) release(map_value.size, map_value.size);
+		}
+
+		[[nodiscard]] const_iterator find(const key_type& key) const noexcept {
+			const size_type slot = map_value.lowerBoundSlot(key);
+			if (slot == map_value.endSlot() || map_value.comp(key, map_value.keys[slot])) return end();
+			return const_iterator(&map_value, slot);
+		}
+
+		[[nodiscard]] bool contains(const key_type& key) const noexcept {
+			const size_type slot = map_value.lowerBoundSlot(key);
+			return slot != map_value.endSlot() && !map_value.comp(key, map_value.keys[slot]);
+		}
+
+		[[nodiscard]] size_type count(const key_type& key) const noexcept {
+			return contains(key);
+		}
+
+		[[nodiscard]] const T& at(const key_type& key) const {
+			const size_type slot = map_value.lowerBoundSlot(key);
+			if (slot == map_value.endSlot() || map_value.comp(key, map_value.keys[slot])) throw std::out_of_range("Invalid key");
+			return map_value.values[slot].second;
+		}
+
+		[[nodiscard]] const_iterator lowerBound(const key_type& key) const noexcept {
+			return const_iterator(&map_value, map_value.lowerBoundSlot(key));
+		}
+
+		[[nodiscard]] const_iterator upperBound(const key_type& key) const noexcept {
+			size_type slot = map_value.lowerBoundSlot(key);
+			if (slot != map_value.endSlot() && !map_value.comp(key, map_value.keys[slot])) slot = map_value.nextSlot(slot);
+			return const_iterator(&map_value, slot);
+		}
+
+		[[nodiscard]] const_iterator begin() const noexcept {
+			return const_iterator(&map_value, map_value.firstSlot());
+		}
+
+		[[nodiscard]] const_iterator end() const noexcept {
+			return const_iterator(&map_value, map_value.endSlot());
+		}
+
+		[[nodiscard]] const_iterator cbegin() const noexcept {
+			return begin();
+		}
+
+		[[nodiscard]] const_iterator cend() const noexcept {
+			return end();
+		}
+
+		[[nodiscard]] size_type size() const noexcept {
+			return map_value.size;
+		}
+
+		[[nodiscard]] bool empty() const noexcept {
+			return !map_value.size;
+		}
+
+		[[nodiscard]] allocator_type getAllocator() const noexcept {
+			return static_cast<allocator_type>(map_value.alloc);
+		}
+
+		[[nodiscard]] key_compare keyComp() const {
+			return map_value.comp;
+		}
+
+	protected:
+		// Values and then keys are constructed in slot order, which is key order, so a throw unwinds the first ones of each
+		template<class It>
+		void build(It first, It last, size_type size) {
+			if (!size) return;
+
+			map_value.size = size;
+			if constexpr (MapValue::btree_layout) map_value.planLayers();
+			else map_value.key_count = size + 1;
+
+			KeyAlloc key_alloc(map_value.alloc);
+			try {
+				map_value.values = map_value.alloc.allocate(map_value.valueSlots());
+				map_value.keys = key_alloc.allocate(map_value.key_count);
+			}
+			catch (...) {
+				release(0, 0);
+				throw;
+			}
+
+			size_type values_built = 0;
+			size_type keys_built = 0;
+			try {
+				for (size_type slot = map_value.firstSlot(); first != last; ++first, slot = map_value.nextSlot(slot)) {
+					construct(map_value.alloc, std::addressof(map_value.values[slot]), *first);
+					++values_built;
+					assert((values_built == 1 || map_value.comp(map_value.values[map_value.prevSlot(slot)].first, map_value.values[slot].first))
+						&& "The range is not sorted or has equal keys");
+				}
+				assert(values_built == size && "The range is shorter than its size");
+
+				for (size_type slot = map_value.firstSlot(); slot != map_value.endSlot(); slot = map_value.nextSlot(slot)) {
+					construct(key_alloc, std::addressof(map_value.keys[slot]), map_value.values[slot].first);
+					++keys_built;
+				}
+			}
+			catch (...) {
+				release(values_built, keys_built);
+				throw;
+			}
+
+			if constexpr (MapValue::btree_layout) {
+				const Key padding = MapValue::paddingKey(map_value.comp);
+				for (size_type i = size; i < map_value.key_count; ++i) map_value.keys[i] = padding;
+				map_value.fillUpperLayers();
+			}
+		}
+
+		// Destroys the first values_built values and keys_built keys in slot order and frees both arrays
+		void release(size_type values_built, size_type keys_built) noexcept {
+			KeyAlloc key_alloc(map_value.alloc);
+			size_type slot = map_value.firstSlot();
+			for (size_type i = 0; i < values_built; ++i, slot = map_value.nextSlot(slot)) {
+				destroy(map_value.alloc, std::addressof(map_value.values[slot]));
+				if (i < keys_built) destroy(key_alloc, std::addressof(map_value.keys[slot]));
+			}
+			if (map_value.values) map_value.alloc.deallocate(map_value.values, map_value.valueSlots());
+			if (map_value.keys) key_alloc.deallocate(map_value.keys, map_value.key_count);
+			map_value.values = nullptr;
+			map_value.keys = nullptr;
+			map_value.key_count = 0;
+			map_value.size = 0;
+		}
+
+		void swapMapValue(FrozenMap& other) noexcept {
+			std::swap(map_value.comp, other.map_value.comp);
+			std::swap(map_value.keys, other.map_value.keys);
+			std::swap(map_value.values, other.map_value.values);
+			std::swap(map_value.key_count, other.map_value.key_count);
+			std::swap(map_value.size, other.map_value.size);
+			std::swap(map_value.layers, other.map_value.layers);
+			std::swap(map_value.layer_offset, other.map_value.layer_offset);
+			std::swap(map_value.proxy, other.map_value.proxy);
+
+			other.map_value.proxy->parent = &other.map_value;
+			map_value.proxy->parent = &map_value;
+		}
+
+		void createProxy() {
+			map_value.createProxy(static_cast<typename AllocTraits::template rebind_alloc<IteratorProxy>>(map_value.alloc));
+		}
+
+		void deleteProxy() {
+			map_value.orphanAll();
+			map_value.deleteProxy(static_cast<typename AllocTraits::template rebind_alloc<IteratorProxy>>(map_value.alloc));
+		}
+
+		MapValue map_value;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+#pragma once
+#include "Map.h"
+
+namespace mylib {
+	template<class Compare>
+	struct IntervalCompare { // orders intervals by their begin, then by their end
+		template<class Interval>
+		[[nodiscard]] bool operator()(const Interval& left, const Interval& right) const {
+			if (comp(left.first, right.first)) return true;
+			if (comp(right.first, left.first)) return false;
+			return comp(left.second, right.second);
+		}
+
+		Compare comp;
+	};
+
+	template<class Key, class Compare>
+	struct IntervalMaxEnd {
+		using aggregate_type = Key;
+
+		template<class Value>
+		[[nodiscard]] static Key lift(const Value& value) { return value.first.second; }
+
+		[[nodiscard]] static Key combine(const Key& left, const Key& right) { return Compare{}(left, right) ? right : left; }
+	};
+
+	// A Map from half-open intervals [begin, end) to values that finds the intervals overlapping a given one in
+	// O(log n + k), as every subtree keeps the greatest end within it. Intervals have to be non-empty, and Compare
+	// has to be stateless, as the subtree maxima are taken with a default-constructed one.
+	template<class Key, class T, class Compare = std::less<Key>, class Allocator = std::allocator<std::pair<const std::pair<Key, Key>, T>>>
+	class IntervalMap : public Map<std::pair<Key, Key>, T, IntervalCompare<Compare>, Allocator, TreeAggregate<IntervalMaxEnd<Key, Compare>>> {
+	public:
+		using Base				= Map<std::pair<Key, Key>, T, IntervalCompare<Compare>, Allocator, TreeAggregate<IntervalMaxEnd<Key, Compare>>>;
+		using allocator_type	= typename Base::allocator_type;
+		using key_type			= typename Base::key_type;
+		using mapped_type		= T;
+		using value_type		= typename Base::value_type;
+		using key_compare		= typename Base::key_compare;
+
+	protected:
+		using NodePtr			= typename Base::NodePtr;
+
+	public:
+		using size_type			= typename Base::size_type;
+		using difference_type	= typename Base::difference_type;
+		using iterator			= typename Base::iterator;
+		using const_iterator	= typename Base::const_iterator;
+
+		IntervalMap() : Base() {}
+
+		explicit IntervalMap(const Allocator& alloc) : Base(alloc) {}
+
+		template<class InputIt>
+		IntervalMap(InputIt first, InputIt last, const Allocator& alloc = Allocator()) : Base(first, last, alloc) {}
+
+		IntervalMap(std::initializer_list<value_type> init, const Allocator& alloc = Allocator()) : Base(init, alloc) {}
+
+		[[nodiscard]] bool overlaps(const Key& begin, const Key& end) const noexcept {
+			return !findOverlapNode(begin, end)->is_nil;
+		}
+
+		// Returns the first interval in key order that overlaps [begin, end), or end().
+		[[nodiscard]] iterator findOverlap(const Key& begin, const Key& end) noexcept {
+			return iterator(&(this->tree_value), findOverlapNode(begin, end));
+		}
+
+		[[nodiscard]] const_iterator findOverlap(const Key& begin, const Key& end) const noexcept {
+			return const_iterator(&(this->tree_value), findOverlapNode(begin, end));
+		}
+
+		// Calls fn for every interval that overlaps [begin, end) in key order.
+		template<class Fn>
+		void forEachOverlap(const Key& begin, const Key& end, Fn fn) {
+			forEachOverlap_(this->tree_value.head->parent, begin, end, fn);
+		}
+
+		template<class Fn>
+		void forEachOverlap(const Key& begin, const Key& end, Fn fn) const {
+			auto const_fn = [&fn](const value_type& value) { fn(value); };
+			forEachOverlap_(this->tree_value.head->parent, begin, end, const_fn);
+		}
+
+	protected:
+		[[nodiscard]] NodePtr findOverlapNode(const Key& begin, const Key& end) const noexcept {
+			const Compare& comp = this->tree_value.comp.comp;
+			NodePtr node = this->tree_value.head->parent;
+			while (!node->is_nil) {
+				// If the left subtree reaches past begin but holds no overlap, all of it starts at or after end,
+				// and so does the rest of the tree
+				if (!node->left->is_nil && comp(begin, node->left->aggregate)) node = node->left;
+				else if (!comp(node->value.first.first, end)) return this->tree_value.head;
+				else if (comp(begin, node->value.first.second)) return node;
+				else node = node->right;
+			}
+			return node;
+		}
+
+		template<class Fn>
+		void forEachOverlap_(NodePtr node, const Key& begin, const Key& end, Fn& fn) const {
+			const Compare& comp = this->tree_value.comp.comp;
+			while (!node->is_nil && comp(begin, node->aggregate)) {
+				forEachOverlap_(node->left, begin, end, fn);
+				if (!comp(node->value.first.first, end)) return;
+				if (comp(begin, node->value.first.second)) fn(node->value);
+				node = node->right;
+			}
+		}
+	};
+}
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include "ContainerUtilities.h"
+#include "ParallelUtilities.h"
 
 namespace mylib {
 	template<class ValueType, class VoidPtr>
@@ -126,6 +127,61 @@ namespace mylib {
 		Alloc& alloc;
 	};
 
+	template<class Alloc>
+	struct ListReuseNodes { // the nodes of a list being overwritten, chained through next and handed out front first
+		using NodePtr = typename std::allocator_traits<Alloc>::pointer;
+		using Node = typename std::allocator_traits<Alloc>::value_type;
+
+		ListReuseNodes(Alloc& alloc, NodePtr head) : first{ head->next }, alloc{ alloc } {
+			if (first == head) first = nullptr;
+			else head->prev->next = nullptr;
+
+			head->next = head;
+			head->prev = head;
+		}
+
+		ListReuseNodes(const ListReuseNodes&) = delete;
+		ListReuseNodes& operator=(const ListReuseNodes&) = delete;
+
+		// Returns a node holding a value made of args, with both links left to the caller
+		template<class... Args>
+		NodePtr reuseOrCreate(Args&&... args) {
+			if (!first) {
+				const NodePtr node = alloc.allocate(1); // throws
+				try {
+					construct(alloc, std::addressof(node->value), std::forward<Args>(args)...); // throws
+				}
+				catch (...) {
+					alloc.deallocate(node, 1);
+					throw;
+				}
+				construct(alloc, std::addressof(node->next), NodePtr{});
+				construct(alloc, std::addressof(node->prev), NodePtr{});
+				return node;
+			}
+
+			const NodePtr node = std::exchange(first, first->next);
+			destroy(alloc, std::addressof(node->value));
+			try {
+				construct(alloc, std::addressof(node->value), std::forward<Args>(args)...); // throws
+			}
+			catch (...) {
+				Node::freeHeadNode(alloc, node);
+				throw;
+			}
+			return node;
+		}
+
+		~ListReuseNodes() {
+			while (first) {
+				Node::freeNode(alloc, std::exchange(first, first->next));
+			}
+		}
+
+		NodePtr first;
+		Alloc& alloc;
+	};
+
 	template<class ValueType, class AllocType, class SizeType, class DifferenceType, class Pointer,
 			 class ConstPoiner, class Reference, class ConstReference, class NodePtrType>
 	struct ListTypesWrapper {
@@ -186,6 +242,13 @@ namespace mylib {
 			return last;
 		}
 
+		void insertNodes(NodePtr where, NodePtr first, NodePtr last) noexcept { // links the chain first..last, both included, before where
+			first->prev = where->prev;
+			where->prev->next = first;
+			last->next = where;
+			where->prev = last;
+		}
+
 		void orphanNonHead() {
 			IteratorBase** orphan_it = &this->proxy->first;
 
@@ -214,12 +277,26 @@ namespace mylib {
 			}
 		}
 
+		void orphanUnlinked() { // orphans iterators to nodes unlinked with a null prev
+			IteratorBase** orphan_it = &this->proxy->first;
+
+			while (*orphan_it) {
+				const NodePtr ptr = static_cast<uncheked_iterator*>(*orphan_it)->ptr;
+
+				if (!ptr->prev) {
+					(*orphan_it)->proxy = nullptr;
+					*orphan_it = (*orphan_it)->next_iterator;
+				}
+				else orphan_it = &(*orphan_it)->next_iterator;
+			}
+		}
+
 		template<class OtherListTypesWrapper>
 		void reparentPtr(NodePtr node, ListValue<OtherListTypesWrapper>& other) {
 			IteratorBase** reparent_it = &other.proxy->first;
 
 			while (*reparent_it) {
-				const NodePtr ptr = static_cast<uncheked_iterator>(*reparent_it)->ptr;
+				const NodePtr ptr = static_cast<uncheked_iterator*>(*reparent_it)->ptr;
 
 				if (ptr == node) {
 					IteratorBase* next_it = (*reparent_it)->next_iterator;
@@ -234,6 +311,44 @@ namespace mylib {
 			}
 		}
 
+		void reparentUnlinked(ListValue& other) { // takes the iterators of other to nodes unlinked with a null prev
+			IteratorBase** reparent_it = &other.proxy->first;
+
+			while (*reparent_it) {
+				const NodePtr ptr = static_cast<uncheked_iterator*>(*reparent_it)->ptr;
+
+				if (!ptr->prev) {
+					IteratorBase* next_it = (*reparent_it)->next_iterator;
+
+					(*reparent_it)->proxy = this->proxy;
+					(*reparent_it)->next_iterator = this->proxy->first;
+					this->proxy->first = *reparent_it;
+
+					*reparent_it = next_it;
+				}
+				else reparent_it = &(*reparent_it)->next_iterator;
+			}
+		}
+
+		void reparentNonHead(ListValue& other) { // takes the iterators to all nodes of other
+			IteratorBase** reparent_it = &other.proxy->first;
+
+			while (*reparent_it) {
+				const NodePtr ptr = static_cast<uncheked_iterator*>(*reparent_it)->ptr;
+
+				if (ptr != other.head) {
+					IteratorBase* next_it = (*reparent_it)->next_iterator;
+
+					(*reparent_it)->proxy = this->proxy;
+					(*reparent_it)->next_iterator = this->proxy->first;
+					this->proxy->first = *reparent_it;
+
+					*reparent_it = next_it;
+				}
+				else reparent_it = &(*reparent_it)->next_iterator;
+			}
+		}
+
 		NodePtr head;
 		size_type size;
 		Alloc alloc;
@@ -557,7 +672,76 @@ namespace mylib {
 			return last;
 		}
 
+		NodePtr unlinkNode(NodePtr node, NodePtr erased) noexcept {
+			list_value.extractNode(node);
+			node->prev = NodePtr{};
+			node->next = erased;
+			return node;
+		}
+
+		void eraseUnlinked(NodePtr erased, size_type count) {
+			if (!count) return;
+
+			list_value.orphanUnlinked();
+			while (erased) {
+				Node::freeNode(list_value.alloc, std::exchange(erased, erased->next));
+			}
+			list_value.size -= count;
+		}
+
+		template<class Predicate>
+		size_type eraseIf_(Predicate&& pred) {
+			const NodePtr head = list_value.head;
+			NodePtr erased{};
+			size_type count = 0;
+
+			for (NodePtr node = head->next; node != head;) {
+				const NodePtr next_node = node->next;
+				if (pred(node->value)) {
+					erased = unlinkNode(node, erased);
+					++count;
+				}
+				node = next_node;
+			}
+
+			eraseUnlinked(erased, count);
+			return count;
+		}
+
 	public:
+		template<class Predicate>
+		size_type eraseIf(Predicate pred) {
+			return eraseIf_(pred);
+		}
+
+		// The predicate is evaluated on thread_count threads at once, so it must be safe to call concurrently.
+		template<class Predicate>
+		size_type eraseIf(Predicate pred, unsigned thread_count) {
+			std::vector<NodePtr> nodes;
+			nodes.reserve(list_value.size);
+			for (NodePtr node = list_value.head->next; node != list_value.head; node = node->next) {
+				nodes.push_back(node);
+			}
+
+			std::vector<unsigned char> erase_flags(nodes.size());
+			parallelFor(nodes.size(), thread_count, [&](std::size_t first, std::size_t last) {
+				for (; first != last; ++first) erase_flags[first] = pred(nodes[first]->value) ? 1 : 0;
+			});
+
+			std::size_t index = 0;
+			return eraseIf_([&](const value_type&) { return erase_flags[index++] != 0; });
+		}
+
+		template<class Predicate>
+		size_type retain(Predicate pred) {
+			return eraseIf_([&pred](value_type& value) { return !pred(value); });
+		}
+
+		template<class Predicate>
+		size_type retain(Predicate pred, unsigned thread_count) {
+			return eraseIf([&pred](value_type& value) { return !pred(value); }, thread_count);
+		}
+
 		void pushBack(const T& value) {
 			emplaceNode(list_value.head, value);
 		}
@@ -644,6 +828,183 @@ namespace mylib {
 			return const_iterator{ &list_value, list_value.head };
 		}
 
+		// The splices and merge move nodes between lists without allocating or copying, and the iterators to the moved
+		// nodes go along to this list. The allocators of both lists have to be equal.
+		void splice(const_iterator where, List& other) {
+			assert(where.getContainer() == &list_value && "Iterator doesn't belong to the container");
+			if (this == &other || !other.list_value.size) return;
+			assert(list_value.alloc == other.list_value.alloc && "Different allocators");
+
+			const NodePtr first = other.list_value.head->next;
+			const NodePtr last = other.list_value.head->prev;
+			other.list_value.extractNodes(first, other.list_value.head);
+			list_value.insertNodes(where.ptr, first, last);
+			list_value.reparentNonHead(other.list_value);
+			list_value.size += std::exchange(other.list_value.size, 0);
+		}
+
+		void splice(const_iterator where, List&& other) {
+			splice(where, other);
+		}
+
+		void splice(const_iterator where, List& other, const_iterator iter) {
+			assert(where.getContainer() == &list_value && "Iterator doesn't belong to the container");
+			assert(iter.getContainer() == &other.list_value && "Iterator doesn't belong to the container");
+			assert(iter.ptr != other.list_value.head && "Cannot splice the end");
+			assert(list_value.alloc == other.list_value.alloc && "Different allocators");
+
+			const NodePtr node = iter.ptr;
+			if (node == where.ptr || node->next == where.ptr) return;
+
+			other.list_value.extractNode(node);
+			list_value.insertNodes(where.ptr, node, node);
+			if (this != &other) {
+				list_value.reparentPtr(node, other.list_value);
+				--other.list_value.size;
+				++list_value.size;
+			}
+		}
+
+		void splice(const_iterator where, List&& other, const_iterator iter) {
+			splice(where, other, iter);
+		}
+
+		// Takes O(1) within a list. Between lists the moved nodes are counted, and if other has iterators, the nodes are
+		// marked with a null prev, so that one pass over the iterators of other finds those to move along.
+		void splice(const_iterator where, List& other, const_iterator first, const_iterator last) {
+			assert(where.getContainer() == &list_value && "Iterator doesn't belong to the container");
+			assert(first.getContainer() == &other.list_value && last.getContainer() == &other.list_value && "Iterator doesn't belong to the container");
+			assert(list_value.alloc == other.list_value.alloc && "Different allocators");
+			if (first.ptr == last.ptr) return;
+
+			const NodePtr first_node = first.ptr;
+			const NodePtr last_node = last.ptr->prev;
+			other.list_value.extractNodes(first_node, last.ptr);
+
+			if (this != &other) {
+				const bool has_iterators = other.list_value.proxy->first != nullptr;
+				size_type count = 0;
+				for (NodePtr node = first_node; node != last.ptr; node = node->next) {
+					if (has_iterators) node->prev = NodePtr{};
+					++count;
+				}
+
+				if (has_iterators) {
+					list_value.reparentUnlinked(other.list_value);
+					for (NodePtr node = first_node; node != last_node; node = node->next) node->next->prev = node;
+				}
+				other.list_value.size -= count;
+				list_value.size += count;
+			}
+
+			list_value.insertNodes(where.ptr, first_node, last_node);
+		}
+
+		void splice(const_iterator where, List&& other, const_iterator first, const_iterator last) {
+			splice(where, other, first, last);
+		}
+
+		// Both lists have to be sorted by cmp. Runs of other are linked in between the nodes of this list, which go first
+		// among equal values, so that other is left empty.
+		template<class Compare>
+		void merge(List& other, Compare cmp) {
+			if (this == &other || !other.list_value.size) return;
+			assert(list_value.alloc == other.list_value.alloc && "Different allocators");
+
+			const NodePtr head = list_value.head;
+			const NodePtr other_head = other.list_value.head;
+			list_value.reparentNonHead(other.list_value);
+
+			NodePtr node = head->next;
+			size_type moved = 0;
+			try {
+				while (other_head->next != other_head) {
+					const NodePtr first = other_head->next;
+					while (node != head && !cmp(first->value, node->value)) node = node->next;
+
+					NodePtr last = first;
+					size_type count = 1;
+					if (node == head) {
+						last = other_head->prev;
+						count = other.list_value.size - moved;
+					}
+					else {
+						for (; last->next != other_head && cmp(last->next->value, node->value); ++count) last = last->next;
+					}
+
+					other.list_value.extractNodes(first, last->next);
+					list_value.insertNodes(node, first, last);
+					moved += count;
+				}
+			}
+			catch (...) { // the nodes other still has get their iterators back
+				for (NodePtr rest = other_head->next; rest != other_head; rest = rest->next) other.list_value.reparentPtr(rest, list_value);
+				other.list_value.size -= moved;
+				list_value.size += moved;
+				throw;
+			}
+			other.list_value.size = 0;
+			list_value.size += moved;
+		}
+
+		template<class Compare>
+		void merge(List&& other, Compare cmp) {
+			merge(other, cmp);
+		}
+
+		void merge(List& other) {
+			merge(other, std::less<>{});
+		}
+
+		void merge(List&& other) {
+			merge(other, std::less<>{});
+		}
+
+		// Swaps the links of every node and of the head, so iterators stay valid and now run the other way
+		void reverse() noexcept {
+			NodePtr node = list_value.head;
+			do {
+				std::swap(node->next, node->prev);
+				node = node->prev;
+			} while (node != list_value.head);
+		}
+
+		// Erases every value that pred finds equal to the last value kept before it, and returns how many went
+		template<class BinaryPredicate>
+		size_type unique(BinaryPredicate pred) {
+			const NodePtr head = list_value.head;
+			NodePtr kept = head->next;
+			if (kept == head) return 0;
+
+			NodePtr erased{};
+			size_type count = 0;
+			for (NodePtr node = kept->next; node != head;) {
+				const NodePtr next_node = node->next;
+				if (pred(kept->value, node->value)) {
+					erased = unlinkNode(node, erased);
+					++count;
+				}
+				else kept = node;
+				node = next_node;
+			}
+
+			eraseUnlinked(erased, count);
+			return count;
+		}
+
+		size_type unique() {
+			return unique(std::equal_to<>{});
+		}
+
+		size_type remove(const T& value) { // value may be an element of the list, as nodes are freed after the walk
+			return eraseIf_([&value](const value_type& element) { return element == value; });
+		}
+
+		template<class Predicate>
+		size_type removeIf(Predicate pred) {
+			return eraseIf_(pred);
+		}
+
 		template<class Compare>
 		void sort(Compare cmp) {
 			std::size_t step = 1;
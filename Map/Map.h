@@ -1,11 +1,12 @@
 #pragma once
+#include <stdexcept>
 #include "Tree.h"
 
 namespace mylib {
-	template<class Key, class T, class Compare = std::less<Key>, class Allocator = std::allocator<std::pair<const Key, T>>>
-	class Map : public Tree<MapTraits<Key, T, Compare, Allocator>> {
+	template<class Key, class T, class Compare = std::less<Key>, class Allocator = std::allocator<std::pair<const Key, T>>, class Augment = TreeNoAugment>
+	class Map : public Tree<MapTraits<Key, T, Compare, Allocator, Augment>> {
 	public:
-		using Base				= Tree<MapTraits<Key, T, Compare, Allocator>>;
+		using Base				= Tree<MapTraits<Key, T, Compare, Allocator, Augment>>;
 		using allocator_type	= typename Base::allocator_type;
 		using key_type			= typename Base::key_type;
 		using mapped_type		= T;
@@ -13,11 +14,11 @@ namespace mylib {
 		using key_compare		= typename Base::key_compare;
 
 	protected:
-		using Node				= TreeNode<value_type, typename std::allocator_traits<allocator_type>::void_pointer>;
-		using Alloc				= typename std::allocator_traits<allocator_type>::template rebind_alloc<Node>;
-		using AllocTraits		= std::allocator_traits<Alloc>;
-		using NodePtr			= typename AllocTraits::pointer;
-		using TreeValue			= TreeValue<MapTraits<Key, T, Compare, Allocator>>;
+		using Node				= typename Base::Node;
+		using Alloc				= typename Base::Alloc;
+		using AllocTraits		= typename Base::AllocTraits;
+		using NodePtr			= typename Base::NodePtr;
+		using TreeValue			= TreeValue<MapTraits<Key, T, Compare, Allocator, Augment>>;
 		using uncheked_iterator = TreeUncheckedIterator<TreeValue>;
 
 	public:
@@ -51,6 +52,8 @@ namespace mylib {
 
 		Map(const Map& other, const Allocator& alloc) : Base(other, alloc) {}
 
+		Map(const Map& other, unsigned thread_count) : Base(other, AllocTraits::select_on_container_copy_construction(other.tree_value.alloc), thread_count) {}
+
 		Map(Map&& other) : Base(std::move(other), std::move(other.tree_value.alloc)) {}
 
 		Map(Map&& other, const Allocator& alloc) : Base(std::move(other), alloc) {}
@@ -63,6 +66,10 @@ namespace mylib {
 			this->insert(init);
 		}
 
+		Map& operator=(const Map& other) = default;
+
+		Map& operator=(Map&& other) = default;
+
 		using Base::insert;
 
 		template<class P, std::enable_if_t<std::is_constructible_v<value_type, P>, int> = 0>
@@ -77,34 +84,202 @@ namespace mylib {
 
 		template<class... Args>
 		std::pair<iterator, bool> tryEmplace(const key_type& key, Args&&... args) {
-			std::pair<NodePtr, bool> result = tryEmplace_(key, std::forward<Args>(args)...);
+			std::pair<NodePtr, bool> result = tryEmplace_(this->findPlaceForNode(key), key, std::forward<Args>(args)...);
 			return { iterator(&(this->tree_value), result.first), result.second };
 		}
 
 		template<class... Args>
 		std::pair<iterator, bool> tryEmplace(key_type&& key, Args&&... args) {
-			std::pair<NodePtr, bool> result = tryEmplace_(std::move(key), std::forward<Args>(args)...);
+			std::pair<NodePtr, bool> result = tryEmplace_(this->findPlaceForNode(key), std::move(key), std::forward<Args>(args)...);
 			return { iterator(&(this->tree_value), result.first), result.second };
 		}
 
 		template<class... Args>
 		iterator tryEmplace(const_iterator hint, const key_type& key, Args&&... args) {
-			return this->emplaceHint(hint, key, std::forward<Args>(args)...);
+			assert(hint.getContainer() == &(this->tree_value) && "Iterator from another container");
+			return iterator(&(this->tree_value), tryEmplace_(this->findPlaceForNodeWithHint(hint.ptr, key), key, std::forward<Args>(args)...).first);
 		}
 
 		template<class... Args>
 		iterator tryEmplace(const_iterator hint, key_type&& key, Args&&... args) {
-			return this->emplaceHint(hint, std::move(key), std::forward<Args>(args)...);
+			assert(hint.getContainer() == &(this->tree_value) && "Iterator from another container");
+			return iterator(&(this->tree_value), tryEmplace_(this->findPlaceForNodeWithHint(hint.ptr, key), std::move(key), std::forward<Args>(args)...).first);
+		}
+
+		template<class M>
+		std::pair<iterator, bool> insertOrAssign(const key_type& key, M&& obj) {
+			std::pair<NodePtr, bool> result = insertOrAssign_(this->findPlaceForNode(key), key, std::forward<M>(obj));
+			return { iterator(&(this->tree_value), result.first), result.second };
 		}
 
-		template<class Key, class... Args>
-		std::pair<NodePtr, bool> tryEmplace_(Key&& key, Args&&... args) { 
+		template<class M>
+		std::pair<iterator, bool> insertOrAssign(key_type&& key, M&& obj) {
+			std::pair<NodePtr, bool> result = insertOrAssign_(this->findPlaceForNode(key), std::move(key), std::forward<M>(obj));
+			return { iterator(&(this->tree_value), result.first), result.second };
+		}
+
+		template<class M>
+		iterator insertOrAssign(const_iterator hint, const key_type& key, M&& obj) {
+			assert(hint.getContainer() == &(this->tree_value) && "Iterator from another container");
+			return iterator(&(this->tree_value), insertOrAssign_(this->findPlaceForNodeWithHint(hint.ptr, key), key, std::forward<M>(obj)).first);
+		}
+
+		template<class M>
+		iterator insertOrAssign(const_iterator hint, key_type&& key, M&& obj) {
+			assert(hint.getContainer() == &(this->tree_value) && "Iterator from another container");
+			return iterator(&(this->tree_value), insertOrAssign_(this->findPlaceForNodeWithHint(hint.ptr, key), std::move(key), std::forward<M>(obj)).first);
+		}
+
+		T& operator[](const key_type& key) {
+			return tryEmplace_(this->findPlaceForNode(key), key).first->value.second;
+		}
+
+		T& operator[](key_type&& key) {
+			return tryEmplace_(this->findPlaceForNode(key), std::move(key)).first->value.second;
+		}
+
+		[[nodiscard]] T& at(const key_type& key) {
+			TreeFindResult<NodePtr> result = this->findPlaceForNode(key);
+			if (!result.duplicate) throw std::out_of_range("Invalid key");
+			return result.location.parent->value.second;
+		}
+
+		[[nodiscard]] const T& at(const key_type& key) const {
 			TreeFindResult<NodePtr> result = this->findPlaceForNode(key);
+			if (!result.duplicate) throw std::out_of_range("Invalid key");
+			return result.location.parent->value.second;
+		}
+
+	protected:
+		template<class K, class... Args>
+		std::pair<NodePtr, bool> tryEmplace_(TreeFindResult<NodePtr> result, K&& key, Args&&... args) { 
 			if (result.duplicate) return { result.location.parent, false };
 			this->checkGrow();
-			NodePtr node_for_insertion = TreeTempNode(this->tree_value.alloc, this->tree_value.head, std::piecewise_construct, std::forward_as_tuple(std::forward<Key>(key)),
+			NodePtr node_for_insertion = TreeTempNode(this->tree_value.alloc, this->tree_value.head, std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
 				std::forward_as_tuple(std::forward<Args>(args)...)).release();
 			return { this->tree_value.insertNode(result.location, node_for_insertion), true };
 		}
+
+		template<class K, class M>
+		std::pair<NodePtr, bool> insertOrAssign_(TreeFindResult<NodePtr> result, K&& key, M&& obj) {
+			if (result.duplicate) {
+				result.location.parent->value.second = std::forward<M>(obj);
+				this->tree_value.updateAugmentToRoot(result.location.parent);
+				return { result.location.parent, false };
+			}
+			this->checkGrow();
+			NodePtr node_for_insertion = TreeTempNode(this->tree_value.alloc, this->tree_value.head, std::forward<K>(key), std::forward<M>(obj)).release();
+			return { this->tree_value.insertNode(result.location, node_for_insertion), true };
+		}
 	};
+
+	// An ordered map that keeps every value inserted, so a key may map to several values. Each new value goes after
+	// those with an equal key, so they stay in the order they were inserted in; find returns the first of them.
+	template<class Key, class T, class Compare = std::less<Key>, class Allocator = std::allocator<std::pair<const Key, T>>, class Augment = TreeNoAugment>
+	class MultiMap : public Tree<MapTraits<Key, T, Compare, Allocator, Augment, true>> {
+	public:
+		using Base				= Tree<MapTraits<Key, T, Compare, Allocator, Augment, true>>;
+		using allocator_type	= typename Base::allocator_type;
+		using key_type			= typename Base::key_type;
+		using mapped_type		= T;
+		using value_type		= typename Base::value_type;
+		using key_compare		= typename Base::key_compare;
+
+	protected:
+		using Node				= typename Base::Node;
+		using Alloc				= typename Base::Alloc;
+		using AllocTraits		= typename Base::AllocTraits;
+		using NodePtr			= typename Base::NodePtr;
+		using TreeValue			= TreeValue<MapTraits<Key, T, Compare, Allocator, Augment, true>>;
+
+	public:
+		using size_type			= typename AllocTraits::size_type;
+		using difference_type	= typename AllocTraits::difference_type;
+		using pointer			= typename AllocTraits::pointer;
+		using const_pointer		= typename AllocTraits::const_pointer;
+		using reference			= value_type&;
+		using const_reference	= const value_type&;
+
+		using iterator			= TreeIterator<TreeValue>;
+		using const_iterator	= TreeConstIterator<TreeValue>;
+
+		MultiMap() : Base(Compare{}, Allocator{}) {}
+
+		explicit MultiMap(const Compare& comp, const Allocator& alloc = Allocator()) : Base(comp, alloc) {}
+
+		explicit MultiMap(const Allocator& alloc) : Base(Compare{}, alloc) {}
+
+		template<class InputIt>
+		MultiMap(InputIt first, InputIt last, const Compare& comp = Compare(), const Allocator& alloc = Allocator()) : Base(comp, alloc) {
+			this->insert(first, last);
+		}
+
+		template<class InputIt>
+		MultiMap(InputIt first, InputIt last, const Allocator& alloc) : Base(Compare{}, alloc) {
+			this->insert(first, last);
+		}
+
+		MultiMap(const MultiMap& other) : Base(other, AllocTraits::select_on_container_copy_construction(other.tree_value.alloc)) {}
+
+		MultiMap(const MultiMap& other, const Allocator& alloc) : Base(other, alloc) {}
+
+		MultiMap(const MultiMap& other, unsigned thread_count) : Base(other, AllocTraits::select_on_container_copy_construction(other.tree_value.alloc), thread_count) {}
+
+		MultiMap(MultiMap&& other) : Base(std::move(other), std::move(other.tree_value.alloc)) {}
+
+		MultiMap(MultiMap&& other, const Allocator& alloc) : Base(std::move(other), alloc) {}
+
+		MultiMap(std::initializer_list<value_type> init, const Compare& comp = Compare(), const Allocator& alloc = Allocator()) : Base(comp, alloc) {
+			this->insert(init);
+		}
+
+		MultiMap(std::initializer_list<value_type> init, const Allocator alloc) : Base(Compare{}, alloc) {
+			this->insert(init);
+		}
+
+		MultiMap& operator=(const MultiMap& other) = default;
+
+		MultiMap& operator=(MultiMap&& other) = default;
+
+		using Base::insert;
+
+		iterator insert(const value_type& value) {
+			return emplace(value);
+		}
+
+		iterator insert(value_type&& value) {
+			return emplace(std::move(value));
+		}
+
+		template<class P, std::enable_if_t<std::is_constructible_v<value_type, P>, int> = 0>
+		iterator insert(P&& value) {
+			return emplace(std::forward<P>(value));
+		}
+
+		template<class P, std::enable_if_t<std::is_constructible_v<value_type, P>, int> = 0>
+		iterator insert(const_iterator hint, P&& value) {
+			return this->emplaceHint(hint, std::forward<P>(value));
+		}
+
+		template<class... Args>
+		iterator emplace(Args&&... args) {
+			return iterator(&(this->tree_value), this->emplace_(std::forward<Args>(args)...).first);
+		}
+	};
+
+	// A Map that keeps subtree sizes, so rank, select and distance take O(log n).
+	template<class Key, class T, class Compare = std::less<Key>, class Allocator = std::allocator<std::pair<const Key, T>>>
+	using OrderStatisticMap = Map<Key, T, Compare, Allocator, TreeOrderStatistics>;
+
+	// A Map that keeps Monoid::combine of the values of every subtree, so rangeAggregate takes O(log n).
+	template<class Key, class T, class Monoid, class Compare = std::less<Key>, class Allocator = std::allocator<std::pair<const Key, T>>>
+	using AggregateMap = Map<Key, T, Compare, Allocator, TreeAggregate<Monoid>>;
+
+	// A Map whose nodes are also linked in key order, so that every iterator step takes O(1) and a single load.
+	template<class Key, class T, class Compare = std::less<Key>, class Allocator = std::allocator<std::pair<const Key, T>>>
+	using ThreadedMap = Map<Key, T, Compare, Allocator, TreeInOrderLinks<>>;
+
+	// A Map whose nodes also keep the first bytes of their keys, so that lookups compare most string keys as integers.
+	template<class Key, class T, class Compare = std::less<Key>, class Allocator = std::allocator<std::pair<const Key, T>>>
+	using KeyPrefixMap = Map<Key, T, Compare, Allocator, TreeKeyPrefix<>>;
 }
\ No newline at end of file
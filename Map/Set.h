@@ -0,0 +1,182 @@
+#pragma once
+#include "Tree.h"
+
+namespace mylib {
+	template<class Key, class Compare = std::less<Key>, class Allocator = std::allocator<Key>, class Augment = TreeNoAugment>
+	class Set : public Tree<SetTraits<Key, Compare, Allocator, Augment>> {
+	public:
+		using Base				= Tree<SetTraits<Key, Compare, Allocator, Augment>>;
+		using allocator_type	= typename Base::allocator_type;
+		using key_type			= typename Base::key_type;
+		using value_type		= typename Base::value_type;
+		using key_compare		= typename Base::key_compare;
+
+	protected:
+		using Node				= typename Base::Node;
+		using Alloc				= typename Base::Alloc;
+		using AllocTraits		= typename Base::AllocTraits;
+		using NodePtr			= typename Base::NodePtr;
+		using TreeValue			= TreeValue<SetTraits<Key, Compare, Allocator, Augment>>;
+
+	public:
+		using size_type			= typename AllocTraits::size_type;
+		using difference_type	= typename AllocTraits::difference_type;
+		using pointer			= typename AllocTraits::pointer;
+		using const_pointer		= typename AllocTraits::const_pointer;
+		using reference			= value_type&;
+		using const_reference	= const value_type&;
+
+		using iterator			= TreeIterator<TreeValue>; // keys are const, so both iterators only read
+		using const_iterator	= TreeConstIterator<TreeValue>;
+
+		Set() : Base(Compare{}, Allocator{}) {}
+
+		explicit Set(const Compare& comp, const Allocator& alloc = Allocator()) : Base(comp, alloc) {}
+
+		explicit Set(const Allocator& alloc) : Base(Compare{}, alloc) {}
+
+		template<class InputIt>
+		Set(InputIt first, InputIt last, const Compare& comp = Compare(), const Allocator& alloc = Allocator()) : Base(comp, alloc) {
+			this->insert(first, last);
+		}
+
+		template<class InputIt>
+		Set(InputIt first, InputIt last, const Allocator& alloc) : Base(Compare{}, alloc) {
+			this->insert(first, last);
+		}
+
+		Set(const Set& other) : Base(other, AllocTraits::select_on_container_copy_construction(other.tree_value.alloc)) {}
+
+		Set(const Set& other, const Allocator& alloc) : Base(other, alloc) {}
+
+		Set(const Set& other, unsigned thread_count) : Base(other, AllocTraits::select_on_container_copy_construction(other.tree_value.alloc), thread_count) {}
+
+		Set(Set&& other) : Base(std::move(other), std::move(other.tree_value.alloc)) {}
+
+		Set(Set&& other, const Allocator& alloc) : Base(std::move(other), alloc) {}
+
+		Set(std::initializer_list<value_type> init, const Compare& comp = Compare(), const Allocator& alloc = Allocator()) : Base(comp, alloc) {
+			this->insert(init);
+		}
+
+		Set(std::initializer_list<value_type> init, const Allocator alloc) : Base(Compare{}, alloc) {
+			this->insert(init);
+		}
+
+		Set& operator=(const Set& other) = default;
+
+		Set& operator=(Set&& other) = default;
+
+		using Base::insert;
+
+		std::pair<iterator, bool> insert(key_type&& key) {
+			return this->emplace(std::move(key));
+		}
+
+		iterator insert(const_iterator hint, const key_type& key) {
+			return this->emplaceHint(hint, key);
+		}
+
+		iterator insert(const_iterator hint, key_type&& key) {
+			return this->emplaceHint(hint, std::move(key));
+		}
+	};
+
+	// A Set that keeps every key inserted, equal ones included. Each new key goes after those equal to it, and find
+	// returns the first of them.
+	template<class Key, class Compare = std::less<Key>, class Allocator = std::allocator<Key>, class Augment = TreeNoAugment>
+	class MultiSet : public Tree<SetTraits<Key, Compare, Allocator, Augment, true>> {
+	public:
+		using Base				= Tree<SetTraits<Key, Compare, Allocator, Augment, true>>;
+		using allocator_type	= typename Base::allocator_type;
+		using key_type			= typename Base::key_type;
+		using value_type		= typename Base::value_type;
+		using key_compare		= typename Base::key_compare;
+
+	protected:
+		using Node				= typename Base::Node;
+		using Alloc				= typename Base::Alloc;
+		using AllocTraits		= typename Base::AllocTraits;
+		using NodePtr			= typename Base::NodePtr;
+		using TreeValue			= TreeValue<SetTraits<Key, Compare, Allocator, Augment, true>>;
+
+	public:
+		using size_type			= typename AllocTraits::size_type;
+		using difference_type	= typename AllocTraits::difference_type;
+		using pointer			= typename AllocTraits::pointer;
+		using const_pointer		= typename AllocTraits::const_pointer;
+		using reference			= value_type&;
+		using const_reference	= const value_type&;
+
+		using iterator			= TreeIterator<TreeValue>;
+		using const_iterator	= TreeConstIterator<TreeValue>;
+
+		MultiSet() : Base(Compare{}, Allocator{}) {}
+
+		explicit MultiSet(const Compare& comp, const Allocator& alloc = Allocator()) : Base(comp, alloc) {}
+
+		explicit MultiSet(const Allocator& alloc) : Base(Compare{}, alloc) {}
+
+		template<class InputIt>
+		MultiSet(InputIt first, InputIt last, const Compare& comp = Compare(), const Allocator& alloc = Allocator()) : Base(comp, alloc) {
+			insert(first, last);
+		}
+
+		template<class InputIt>
+		MultiSet(InputIt first, InputIt last, const Allocator& alloc) : Base(Compare{}, alloc) {
+			insert(first, last);
+		}
+
+		MultiSet(const MultiSet& other) : Base(other, AllocTraits::select_on_container_copy_construction(other.tree_value.alloc)) {}
+
+		MultiSet(const MultiSet& other, const Allocator& alloc) : Base(other, alloc) {}
+
+		MultiSet(const MultiSet& other, unsigned thread_count) : Base(other, AllocTraits::select_on_container_copy_construction(other.tree_value.alloc), thread_count) {}
+
+		MultiSet(MultiSet&& other) : Base(std::move(other), std::move(other.tree_value.alloc)) {}
+
+		MultiSet(MultiSet&& other, const Allocator& alloc) : Base(std::move(other), alloc) {}
+
+		MultiSet(std::initializer_list<value_type> init, const Compare& comp = Compare(), const Allocator& alloc = Allocator()) : Base(comp, alloc) {
+			insert(init);
+		}
+
+		MultiSet(std::initializer_list<value_type> init, const Allocator alloc) : Base(Compare{}, alloc) {
+			insert(init);
+		}
+
+		MultiSet& operator=(const MultiSet& other) = default;
+
+		MultiSet& operator=(MultiSet&& other) = default;
+
+		template<class InputIt>
+		void insert(InputIt first, InputIt last) {
+			Base::insert(first, last);
+		}
+
+		void insert(std::initializer_list<value_type> init) {
+			Base::insert(init);
+		}
+
+		iterator insert(const key_type& key) {
+			return emplace(key);
+		}
+
+		iterator insert(key_type&& key) {
+			return emplace(std::move(key));
+		}
+
+		iterator insert(const_iterator hint, const key_type& key) {
+			return this->emplaceHint(hint, key);
+		}
+
+		iterator insert(const_iterator hint, key_type&& key) {
+			return this->emplaceHint(hint, std::move(key));
+		}
+
+		template<class... Args>
+		iterator emplace(Args&&... args) {
+			return iterator(&(this->tree_value), this->emplace_(std::forward<Args>(args)...).first);
+		}
+	};
+}
\ No newline at end of file
@@ -1,19 +1,152 @@
 #pragma once
+#include <string>
+#include <cstdint>
 #include "ContainerUtilities.h"
+#include "ParallelUtilities.h"
 
 namespace mylib {
-	
-	template<class ValueType, class VoidPtr>
-	struct TreeNode {
+	// An augment keeps extra data in every node of the tree: the node inherits NodeData, and update recomputes it from
+	// the node and its children whenever they change. The data of the head node stays value-initialized. An augment
+	// whose update does nothing sets updates_to_root to false, which spares insertions and erasures the walk to the root.
+	struct TreeNoAugment {
+		struct NodeData {};
+
+		template<class NodePtr>
+		static void update(NodePtr) noexcept {}
+
+		static constexpr bool updates_to_root = false;
+	};
+
+	template<class Augment, class = void>
+	struct TreeUpdatesToRoot : std::true_type {};
+
+	template<class Augment>
+	struct TreeUpdatesToRoot<Augment, std::void_t<decltype(Augment::updates_to_root)>> : std::bool_constant<Augment::updates_to_root> {};
+
+	struct TreeSubtreeSize {
+		std::size_t subtree_size;
+	};
+
+	struct TreeOrderStatistics {
+		using NodeData = TreeSubtreeSize;
+
+		template<class NodePtr>
+		static void update(NodePtr node) noexcept {
+			node->subtree_size = node->left->subtree_size + node->right->subtree_size + 1;
+		}
+	};
+
+	template<class Aggregate>
+	struct TreeSubtreeAggregate {
+		Aggregate aggregate;
+	};
+
+	// Keeps the aggregate of the values of every subtree in their key order. Monoid provides aggregate_type, lift(value)
+	// and an associative combine(left, right), none of which may throw; identity() is only needed by rangeAggregate.
+	// A value changed in place through an iterator or operator[] has to be followed by refreshAggregate.
+	template<class Monoid>
+	struct TreeAggregate {
+		using monoid_type	= Monoid;
+		using NodeData		= TreeSubtreeAggregate<typename Monoid::aggregate_type>;
+
+		template<class NodePtr>
+		static void update(NodePtr node) noexcept {
+			typename Monoid::aggregate_type aggregate = Monoid::lift(node->value);
+			if (!node->left->is_nil) aggregate = Monoid::combine(node->left->aggregate, aggregate);
+			if (!node->right->is_nil) aggregate = Monoid::combine(aggregate, node->right->aggregate);
+			node->aggregate = std::move(aggregate);
+		}
+	};
+
+	template<class T>
+	struct TreeMappedSum {
+		using aggregate_type = T;
+
+		[[nodiscard]] static T identity() { return T{}; }
+
+		template<class Value>
+		[[nodiscard]] static T lift(const Value& value) { return value.second; }
+
+		[[nodiscard]] static T combine(const T& left, const T& right) { return left + right; }
+	};
+
+	template<class T>
+	struct TreeMappedMax {
+		using aggregate_type = T;
+
+		[[nodiscard]] static T identity() { return std::numeric_limits<T>::lowest(); }
+
+		template<class Value>
+		[[nodiscard]] static T lift(const Value& value) { return value.second; }
+
+		[[nodiscard]] static T combine(const T& left, const T& right) { return left < right ? right : left; }
+	};
+
+	// Links every node to its in-order neighbours as well, so that iterators step in O(1) with a single load at the cost
+	// of two more pointers per node. The set operations, build and copies relink the whole tree, in O(n).
+	template<class Augment = TreeNoAugment>
+	struct TreeInOrderLinks : Augment {
+		static constexpr bool in_order_links = true;
+	};
+
+	template<class Augment, class = void>
+	struct TreeHasInOrderLinks : std::false_type {};
+
+	template<class Augment>
+	struct TreeHasInOrderLinks<Augment, std::void_t<decltype(Augment::in_order_links)>> : std::bool_constant<Augment::in_order_links> {};
+
+	// The order-preserving prefix of a key that TreeKeyPrefix keeps in the nodes. Of two keys with different prefixes,
+	// the one with the smaller prefix has to go first under the Compare of the tree; keys with equal prefixes are
+	// compared in full. Specialize it for other key types; get may not throw.
+	template<class Key, class = void>
+	struct TreeKeyPrefixOf;
+
+	template<class CharT, class Traits, class Alloc>
+	struct TreeKeyPrefixOf<std::basic_string<CharT, Traits, Alloc>, std::enable_if_t<sizeof(CharT) == 1>> { // the first 8 bytes, big-endian
+		[[nodiscard]] static std::uint64_t get(const std::basic_string<CharT, Traits, Alloc>& key) noexcept {
+			std::uint64_t prefix = 0;
+			const std::size_t length = std::min<std::size_t>(key.size(), 8);
+			for (std::size_t i = 0; i < length; ++i) prefix |= std::uint64_t{ static_cast<unsigned char>(key[i]) } << (56 - 8 * i);
+			return prefix;
+		}
+	};
+
+	// Keeps TreeKeyPrefixOf<Key> of the key in every node, so that lookups compare the prefixes as integers and call
+	// Compare only when they are equal. For string keys this spares most loads from the heap buffers of the strings.
+	template<class Augment = TreeNoAugment>
+	struct TreeKeyPrefix : Augment {
+		struct NodeData : Augment::NodeData {
+			std::uint64_t key_prefix;
+		};
+
+		static constexpr bool keeps_key_prefix = true;
+	};
+
+	template<class Augment, class = void>
+	struct TreeHasKeyPrefix : std::false_type {};
+
+	template<class Augment>
+	struct TreeHasKeyPrefix<Augment, std::void_t<decltype(Augment::keeps_key_prefix)>> : std::bool_constant<Augment::keeps_key_prefix> {};
+
+	template<class NodeData, class NodePtr>
+	struct TreeLinkedNodeData : NodeData {
+		NodePtr next_node;
+		NodePtr prev_node;
+	};
+
+	template<class ValueType, class VoidPtr, class NodeData = TreeNoAugment::NodeData, bool InOrderLinks = false>
+	struct TreeNode : std::conditional_t<InOrderLinks,
+			TreeLinkedNodeData<NodeData, typename std::pointer_traits<VoidPtr>::template rebind<TreeNode<ValueType, VoidPtr, NodeData, InOrderLinks>>>, NodeData> {
 		using value_type = ValueType;
 		using NodePtr = typename std::pointer_traits<VoidPtr>::template rebind<TreeNode>;
+		using Data = std::conditional_t<InOrderLinks, TreeLinkedNodeData<NodeData, NodePtr>, NodeData>;
 
 		NodePtr left;
 		NodePtr parent;
 		NodePtr right;
 		ValueType value;
 		bool is_nil;
-		std::size_t height;
+		unsigned char height; // shares the padding after value with is_nil, an AVL tree of 2^64 nodes is below 93 levels
 
 		TreeNode(const TreeNode&) = delete;
 		TreeNode(TreeNode&&) = delete;
@@ -22,11 +155,16 @@ namespace mylib {
 		static NodePtr createHeadNode(Alloc& alloc) {
 			static_assert(std::is_same_v<Alloc::value_type, TreeNode>, "Mismatch of tree node type and value type of allocator!");
 			const auto new_head_node = alloc.allocate(1);
+			construct(alloc, static_cast<Data*>(unfancy(new_head_node)));
 			construct(alloc, std::addressof(new_head_node->left), new_head_node);
 			construct(alloc, std::addressof(new_head_node->parent), new_head_node);
 			construct(alloc, std::addressof(new_head_node->right), new_head_node);
 			new_head_node->is_nil = true;
 			new_head_node->height = 0;
+			if constexpr (InOrderLinks) {
+				new_head_node->next_node = new_head_node;
+				new_head_node->prev_node = new_head_node;
+			}
 			return new_head_node;
 		}
 
@@ -34,10 +172,17 @@ namespace mylib {
 		static NodePtr createNode(Alloc& alloc, NodePtr head_node, ValueArgs&&... value_args) {
 			static_assert(std::is_same_v<Alloc::value_type, TreeNode>, "Mismatch of tree node type and value type of allocator!");
 			const auto new_node = alloc.allocate(1);
+			construct(alloc, static_cast<Data*>(unfancy(new_node)));
 			construct(alloc, std::addressof(new_node->left), head_node);
 			construct(alloc, std::addressof(new_node->parent), head_node);
 			construct(alloc, std::addressof(new_node->right), head_node);
-			construct(alloc, std::addressof(new_node->value), std::forward<ValueArgs>(value_args)...);
+			try {
+				construct(alloc, std::addressof(new_node->value), std::forward<ValueArgs>(value_args)...);
+			}
+			catch (...) {
+				freeHeadNode(alloc, new_node);
+				throw;
+			}
 			new_node->is_nil = false;
 			new_node->height = 1;
 			return new_node;
@@ -46,6 +191,7 @@ namespace mylib {
 		template<class Alloc>
 		static void freeHeadNode(Alloc& alloc, NodePtr head_node) {
 			static_assert(std::is_same_v<Alloc::value_type, TreeNode>, "Mismatch of tree node type and value type of allocator!");
+			destroy(alloc, static_cast<Data*>(unfancy(head_node)));
 			destroy(alloc, std::addressof(head_node->left));
 			destroy(alloc, std::addressof(head_node->parent));
 			destroy(alloc, std::addressof(head_node->right));
@@ -66,7 +212,7 @@ namespace mylib {
 		using Node = typename std::pointer_traits<NodePtr>::element_type;
 
 		template<class... Args>
-		TreeTempNode(Allocator& alloc, NodePtr head, Args... args) : ptr{ Node::createNode(alloc, head, std::forward<Args>(args)...) }, alloc{alloc} {}
+		TreeTempNode(Allocator& alloc, NodePtr head, Args&&... args) : ptr{ Node::createNode(alloc, head, std::forward<Args>(args)...) }, alloc{alloc} {}
 
 		NodePtr release() {
 			return std::exchange(ptr, nullptr);
@@ -83,30 +229,223 @@ namespace mylib {
 		Allocator& alloc;
 	};
 	
+	template<class Allocator>
+	struct TreeTempChain {
+		using NodePtr = typename std::allocator_traits<Allocator>::pointer;
+		using Node = typename std::pointer_traits<NodePtr>::element_type;
+
+		TreeTempChain(Allocator& alloc) : first{}, last{}, count{}, alloc{ alloc } {}
+
+		void push(NodePtr node) noexcept {
+			if (count) last->right = node;
+			else first = node;
+			last = node;
+			++count;
+		}
+
+		NodePtr release() noexcept {
+			count = 0;
+			return first;
+		}
+
+		TreeTempChain(const TreeTempChain&) = delete;
+		TreeTempChain& operator=(const TreeTempChain&) = delete;
+
+		~TreeTempChain() {
+			for (; count; --count) {
+				Node::freeNode(alloc, std::exchange(first, first->right));
+			}
+		}
+
+		NodePtr first;
+		NodePtr last;
+		std::size_t count;
+		Allocator& alloc;
+	};
+	
+	template<class TreeValue>
+	struct TreeReuseCache { // the nodes of a tree being overwritten, handed out leaf first so that the rest stays a tree
+		using Alloc		= typename TreeValue::Alloc;
+		using Node		= typename TreeValue::Node;
+		using NodePtr	= typename TreeValue::NodePtr;
+
+		TreeReuseCache(TreeValue& tree_value) : next{}, tree_value{ tree_value } {
+			const NodePtr head = tree_value.head;
+			if (!head->parent->is_nil) next = lastLeaf(head->parent);
+
+			head->left		= head;
+			head->parent	= head;
+			head->right		= head;
+			tree_value.size	= 0;
+			tree_value.relinkInOrder();
+			tree_value.orphanNonHead(); // every node is either reused or freed
+		}
+
+		template<class... Args>
+		NodePtr reuseOrCreate(Args&&... args) {
+			if (!next) return TreeTempNode(tree_value.alloc, tree_value.head, std::forward<Args>(args)...).release();
+
+			const NodePtr node = extract();
+			destroy(tree_value.alloc, std::addressof(node->value));
+			try {
+				construct(tree_value.alloc, std::addressof(node->value), std::forward<Args>(args)...);
+			}
+			catch (...) {
+				Node::freeHeadNode(tree_value.alloc, node);
+				throw;
+			}
+
+			node->left		= tree_value.head;
+			node->parent	= tree_value.head;
+			node->right		= tree_value.head;
+			node->height	= 1;
+			return node;
+		}
+
+		TreeReuseCache(const TreeReuseCache&) = delete;
+		TreeReuseCache& operator=(const TreeReuseCache&) = delete;
+
+		~TreeReuseCache() {
+			while (next) {
+				Node::freeNode(tree_value.alloc, extract());
+			}
+		}
+
+		[[nodiscard]] static NodePtr lastLeaf(NodePtr node) noexcept {
+			while (true) {
+				if (!node->right->is_nil) node = node->right;
+				else if (!node->left->is_nil) node = node->left;
+				else return node;
+			}
+		}
+
+		NodePtr extract() noexcept { // right subtrees go first, so a parent is a leaf once its left child is taken
+			const NodePtr node		= next;
+			const NodePtr parent	= node->parent;
+
+			if (parent->is_nil) next = nullptr;
+			else if (parent->right == node) {
+				parent->right = tree_value.head;
+				next = parent->left->is_nil ? parent : lastLeaf(parent->left);
+			}
+			else {
+				parent->left = tree_value.head;
+				next = parent;
+			}
+
+			return node;
+		}
+
+		NodePtr next;
+		TreeValue& tree_value;
+	};
+
+	template<class NodePtr>
+	struct TreeDiscarded { // subtrees left out of a set operation, chained through the parent links of their roots
+		TreeDiscarded() : first{}, last{} {}
+
+		void push(NodePtr subtree) noexcept {
+			if (subtree->is_nil) return;
+			if (!first) last = subtree;
+			subtree->parent = first;
+			first = subtree;
+		}
+
+		void append(TreeDiscarded& other) noexcept {
+			if (!other.first) return;
+			other.last->parent = first;
+			if (!first) last = other.last;
+			first = other.first;
+		}
+
+		NodePtr first;
+		NodePtr last;
+	};
+
 	template<class Key, class... Args>
 	struct KeyExtractor {
 		static const bool extractable = false;
 	};
 
-	template<class Key, class Second>
-	struct KeyExtractor<Key, Key, Second> {
-		static const bool extractable = true;
+	template<class Key, class First, class Second>
+	struct KeyExtractor<Key, First, Second> {
+		using key_type	= Key;
+		using Converter	= KeyConverter<Key, First>;
+
+		static const bool extractable = Converter::convertible;
 
-		static const Key& extract(const Key& key, const Second& second) {
-			return key;
+		template<bool Views>
+		static decltype(auto) extract(const First& first, const Second&) {
+			return Converter::template convert<Views>(first);
+		}
+
+		template<class FirstArg, class SecondArg>
+		static auto replaceKey(Key&& key, FirstArg&&, SecondArg&& second) {
+			return std::forward_as_tuple(std::move(key), std::forward<SecondArg>(second));
 		}
 	};
 
 	template<class Key, class First, class Second>
 	struct KeyExtractor<Key, std::pair<First, Second>> {
-		static const bool extractable = std::is_same_v<Key, typename std::decay_t<First>>;
+		using key_type	= Key;
+		using Converter	= KeyConverter<Key, std::decay_t<First>>;
 
-		static const Key& extract(const std::pair<First, Second>& value) {
-			return value.first;
+		static const bool extractable = Converter::convertible;
+
+		template<bool Views>
+		static decltype(auto) extract(const std::pair<First, Second>& value) {
+			return Converter::template convert<Views>(value.first);
+		}
+
+		template<class Pair>
+		static auto replaceKey(Key&& key, Pair&& value) {
+			return std::forward_as_tuple(std::move(key), std::get<1>(std::forward<Pair>(value)));
 		}
 	};
 
-	template<class Key, class T, class Compare, class Allocator>
+	template<class Key, class... KeyArgs, class ValueArgs>
+	struct KeyExtractor<Key, std::piecewise_construct_t, std::tuple<KeyArgs...>, ValueArgs> {
+		using key_type	= Key;
+		using Converter	= KeyConverter<Key, std::decay_t<KeyArgs>...>;
+
+		static const bool extractable = Converter::convertible;
+
+		template<bool Views>
+		static decltype(auto) extract(std::piecewise_construct_t, const std::tuple<KeyArgs...>& key_args, const ValueArgs&) {
+			return std::apply([](const auto&... args) -> decltype(auto) { return Converter::template convert<Views>(args...); }, key_args);
+		}
+
+		template<class KeyTuple, class ValueTuple>
+		static auto replaceKey(Key&& key, std::piecewise_construct_t, KeyTuple&&, ValueTuple&& value_args) { // the key tuple is held by value
+			return std::tuple<std::piecewise_construct_t, std::tuple<Key&&>, ValueTuple&&>(std::piecewise_construct, std::tuple<Key&&>(std::move(key)), std::forward<ValueTuple>(value_args));
+		}
+	};
+
+	template<class Key, class... Args>
+	struct SetKeyExtractor {
+		static const bool extractable = false;
+	};
+
+	template<class Key, class Arg>
+	struct SetKeyExtractor<Key, Arg> {
+		using key_type	= Key;
+		using Converter	= KeyConverter<Key, Arg>;
+
+		static const bool extractable = Converter::convertible;
+
+		template<bool Views>
+		static decltype(auto) extract(const Arg& arg) {
+			return Converter::template convert<Views>(arg);
+		}
+
+		template<class ArgType>
+		static auto replaceKey(Key&& key, ArgType&&) {
+			return std::forward_as_tuple(std::move(key));
+		}
+	};
+
+	// With Multi the tree keeps equal keys as separate nodes, each inserted after the ones already there
+	template<class Key, class T, class Compare, class Allocator, class Augment = TreeNoAugment, bool Multi = false>
 	class MapTraits {
 	public:
 		using key_type = Key;
@@ -114,6 +453,9 @@ namespace mylib {
 		using value_type = std::pair<const Key, T>;
 		using key_compare = Compare;
 		using allocator_type = Allocator;
+		using augment_type = Augment;
+
+		static constexpr bool multi_keys = Multi;
 
 		template<class... Args>
 		using KeyExtractor = KeyExtractor<Key, Args...>;
@@ -124,6 +466,25 @@ namespace mylib {
 		}
 	};
 
+	template<class Key, class Compare, class Allocator, class Augment = TreeNoAugment, bool Multi = false>
+	class SetTraits {
+	public:
+		using key_type = Key;
+		using value_type = const Key;
+		using key_compare = Compare;
+		using allocator_type = Allocator;
+		using augment_type = Augment;
+
+		static constexpr bool multi_keys = Multi;
+
+		template<class... Args>
+		using KeyExtractor = SetKeyExtractor<Key, Args...>;
+
+		static const key_type& getKeyFromValue(const key_type& value) {
+			return value;
+		}
+	};
+
 	enum class NodeChild {
 		left,
 		right,
@@ -141,20 +502,6 @@ namespace mylib {
 		bool duplicate;
 	};
 
-	enum class Rotate {
-		smallLeft,
-		bigLeft,
-		smallRight,
-		bigRight,
-		none
-	};
-
-	template<class NodePtr>
-	struct CheckBalanceResult {
-		NodePtr node;
-		Rotate rotate;
-	};
-
 	template<class TreeValue>
 	class TreeUncheckedIterator;
 
@@ -173,8 +520,9 @@ namespace mylib {
 		using reference			= value_type&;
 		using const_reference	= const value_type&;
 		using key_compare		= typename Traits::key_compare;
+		using Augment			= typename Traits::augment_type;
 		
-		using Node			= TreeNode<value_type, typename std::allocator_traits<allocator_type>::void_pointer>;
+		using Node			= TreeNode<value_type, typename std::allocator_traits<allocator_type>::void_pointer, typename Augment::NodeData, TreeHasInOrderLinks<Augment>::value>;
 		using Alloc			= typename std::allocator_traits<allocator_type>::template rebind_alloc<Node>;
 		using AllocTraits	= std::allocator_traits<Alloc>;
 		using NodePtr		= typename AllocTraits::pointer;
@@ -209,21 +557,91 @@ namespace mylib {
 			return node;
 		}
 
+		static constexpr bool in_order_links = TreeHasInOrderLinks<Augment>::value;
+
+		static constexpr bool keeps_key_prefix = TreeHasKeyPrefix<Augment>::value;
+
+		template<class K>
+		static constexpr bool uses_key_prefix = keeps_key_prefix && std::is_same_v<K, key_type>;
+
+		static void setKeyPrefix(NodePtr node) noexcept {
+			if constexpr (keeps_key_prefix) node->key_prefix = TreeKeyPrefixOf<key_type>::get(Traits::getKeyFromValue(node->value));
+		}
+
+		template<class K>
+		[[nodiscard]] static std::uint64_t keyPrefixOf(const K& key) noexcept {
+			if constexpr (uses_key_prefix<K>) return TreeKeyPrefixOf<key_type>::get(key);
+			else return 0;
+		}
+
+		// Orders the node against a key by the prefixes alone: negative when the node goes first, positive when the key
+		// does, and zero when the prefixes are equal or not kept
+		template<class K>
+		[[nodiscard]] static int comparePrefix(NodePtr node, std::uint64_t key_prefix) noexcept {
+			if constexpr (uses_key_prefix<K>) return (node->key_prefix > key_prefix) - (node->key_prefix < key_prefix);
+			else return 0;
+		}
+
+		[[nodiscard]] static NodePtr nextNode(NodePtr node) noexcept {
+			if constexpr (in_order_links) return node->next_node;
+			else return nextInTree(node);
+		}
+
+		[[nodiscard]] static NodePtr prevNode(NodePtr node) noexcept {
+			if constexpr (in_order_links) return node->prev_node;
+			else return prevInTree(node);
+		}
+
+		[[nodiscard]] static NodePtr nextInTree(NodePtr node) noexcept {
+			if (node->is_nil) return node->left;
+			if (node->right->is_nil) {
+				while (!node->parent->is_nil && node->parent->right == node) {
+					node = node->parent;
+				}
+				return node->parent;
+			}
+			return minInSubTree(node->right);
+		}
+
+		[[nodiscard]] static NodePtr prevInTree(NodePtr node) noexcept {
+			if (node->is_nil) return node->right;
+			if (node->left->is_nil) {
+				while (!node->parent->is_nil && node->parent->left == node) {
+					node = node->parent;
+				}
+				return node->parent;
+			}
+			return maxInSubTree(node->left);
+		}
+
+		static void copyShape(NodePtr node, NodePtr source) noexcept {
+			node->height = source->height;
+			static_cast<typename Augment::NodeData&>(*node) = static_cast<const typename Augment::NodeData&>(*source);
+		}
+
 		[[nodiscard]] static std::ptrdiff_t differenceHeights(NodePtr node) noexcept {
 			return node->right->height - node->left->height;
 		}
 
 		NodePtr insertNode(const NodeID<NodePtr> loc, NodePtr new_node) noexcept {
 			new_node->parent = loc.parent;
+			setKeyPrefix(new_node);
 			++size;
 
 			if (loc.parent == head) { // If inserted first value
 				head->left		= new_node;
 				head->parent	= new_node;
 				head->right		= new_node;
+				if constexpr (in_order_links) linkBetween(new_node, head, head);
+				Augment::update(new_node);
 				return new_node;
 			}
 
+			if constexpr (in_order_links) {
+				if (loc.child == NodeChild::left) linkBetween(new_node, loc.parent->prev_node, loc.parent);
+				else linkBetween(new_node, loc.parent, loc.parent->next_node);
+			}
+
 			if (loc.child == NodeChild::left) {
 				loc.parent->left = new_node;
 				if (loc.parent == head->left) head->left = new_node;
@@ -233,66 +651,90 @@ namespace mylib {
 				if (loc.parent == head->right) head->right = new_node;
 			}
 
-			changeHeights(new_node->parent);
-			balanceTree(new_node);
+			updateAugmentToRoot(new_node);
+			rebalance(new_node->parent);
 			return new_node;
 		}
 
-		void changeHeights(NodePtr node) noexcept {
-			std::size_t max_height;
-			while (!node->is_nil && (max_height = node->left->height > node->right->height ? node->left->height + 1 : node->right->height + 1) != node->height) {
-				node->height = max_height;
-				node = node->parent;
+		// Links the next count nodes of a chain joined through the right links into a perfectly balanced subtree,
+		// setting heights and augments bottom-up, and leaves chain at the node that follows them.
+		NodePtr linkBalanced(NodePtr& chain, size_type count) noexcept {
+			if (!count) return head;
+
+			const NodePtr left = linkBalanced(chain, count / 2);
+			const NodePtr root = chain;
+			chain = chain->right;
+			const NodePtr right = linkBalanced(chain, count - count / 2 - 1);
+
+			root->left	= left;
+			root->right = right;
+			if (!left->is_nil) left->parent = root;
+			if (!right->is_nil) right->parent = root;
+			root->height = std::max(left->height, right->height) + 1;
+			setKeyPrefix(root);
+			Augment::update(root);
+			return root;
+		}
+
+		static void linkBetween(NodePtr node, NodePtr prev, NodePtr next) noexcept {
+			node->prev_node = prev;
+			node->next_node = next;
+			prev->next_node = node;
+			next->prev_node = node;
+		}
+
+		// Rebuilds the in-order links after the tree was put together other than by insertNode and extractNode
+		void relinkInOrder() noexcept {
+			if constexpr (in_order_links) {
+				NodePtr prev = head;
+				for (NodePtr node = head->left; !node->is_nil; node = nextInTree(node)) {
+					prev->next_node = node;
+					node->prev_node = prev;
+					prev = node;
+				}
+				prev->next_node = head;
+				head->prev_node = prev;
 			}
 		}
 
-		[[nodiscard]] CheckBalanceResult<NodePtr> checkBalance(NodePtr node) const noexcept {
-			CheckBalanceResult<NodePtr> result{ node, Rotate::none };
-			while (!result.node->is_nil) {
-				if (differenceHeights(result.node) == 2) {
-					if (differenceHeights(result.node->right) >= 0) result.rotate = Rotate::smallLeft;
-					else result.rotate = Rotate::bigLeft;
-					return result;
-				}
-				if (differenceHeights(result.node) == -2) {
-					if (differenceHeights(result.node->left) <= 0) result.rotate = Rotate::smallRight;
-					else result.rotate = Rotate::bigRight;
-					return result;
-				}
-				result.node = result.node->parent;
+		static void updateAugmentToRoot(NodePtr node) noexcept {
+			if constexpr (TreeUpdatesToRoot<Augment>::value) {
+				for (; !node->is_nil; node = node->parent) Augment::update(node);
 			}
-			return result;
 		}
 
-		void balanceTree(NodePtr node) noexcept {
-			CheckBalanceResult<NodePtr> result = checkBalance(node);
-
-			if (result.rotate != Rotate::none) {
-				switch (result.rotate) {
-				case Rotate::smallLeft:
-					leftRotate(result.node);
-					break;
+		// Walks up from node restoring heights and rotating where the children differ in height by two, in one pass.
+		// Stops at the first node whose height stays the same, as nothing above it changes then.
+		void rebalance(NodePtr node) noexcept {
+			while (!node->is_nil) {
+				const unsigned char old_height = node->height;
+				const std::ptrdiff_t difference = differenceHeights(node);
 
-				case Rotate::bigLeft:
-					rightRotate(result.node->right);
-					leftRotate(result.node);
-					break;
-
-				case Rotate::smallRight:
-					rightRotate(result.node);
-					break;
-
-				case Rotate::bigRight:
-					leftRotate(result.node->left);
-					rightRotate(result.node);
+				if (difference > 1) {
+					if (differenceHeights(node->right) < 0) rightRotate(node->right);
+					leftRotate(node);
+					node = node->parent;
+				}
+				else if (difference < -1) {
+					if (differenceHeights(node->left) > 0) leftRotate(node->left);
+					rightRotate(node);
+					node = node->parent;
 				}
-				changeHeights(result.node->parent->parent);
+				else node->height = std::max(node->left->height, node->right->height) + 1;
+
+				if (node->height == old_height) return;
+				node = node->parent;
 			}
 		}
 
 		void extractNode(NodePtr erased_node) noexcept {
 			NodePtr balance_node;
 
+			if constexpr (in_order_links) {
+				erased_node->prev_node->next_node = erased_node->next_node;
+				erased_node->next_node->prev_node = erased_node->prev_node;
+			}
+
 			if (erased_node->left->is_nil && erased_node->right->is_nil) { // if erasing node is a leaf
 				balance_node = erased_node->parent;
 
@@ -347,7 +789,8 @@ namespace mylib {
 						if (!replace_node->left->is_nil) replace_node->left->parent = replace_node;
 					}
 
-					balance_node = replace_node;
+					balance_node			= replace_node;
+					replace_node->height	= erased_node->height; // so that rebalance goes on up if it decreases
 				}
 
 				replace_node->parent = erased_node->parent;
@@ -357,8 +800,8 @@ namespace mylib {
 			}
 
 			--size;
-			changeHeights(balance_node);
-			balanceTree(balance_node);
+			updateAugmentToRoot(balance_node);
+			rebalance(balance_node);
 		}
 
 		void orphanPtr(NodePtr node) noexcept {
@@ -374,6 +817,32 @@ namespace mylib {
 			}
 		}
 
+		void orphanNonHead() noexcept {
+			IteratorBase** orphan_it = &proxy->first;
+			while (*orphan_it) {
+				const NodePtr ptr = static_cast<uncheked_iterator*>(*orphan_it)->ptr;
+				
+				if (ptr != head) {
+					(*orphan_it)->proxy = nullptr;
+					*orphan_it = (*orphan_it)->next_iterator;
+				}
+				else orphan_it = &(*orphan_it)->next_iterator;
+			}
+		}
+
+		void orphanUnlinked() noexcept { // orphans iterators to nodes unlinked with a null parent
+			IteratorBase** orphan_it = &proxy->first;
+			while (*orphan_it) {
+				const NodePtr ptr = static_cast<uncheked_iterator*>(*orphan_it)->ptr;
+				
+				if (!ptr->parent) {
+					(*orphan_it)->proxy = nullptr;
+					*orphan_it = (*orphan_it)->next_iterator;
+				}
+				else orphan_it = &(*orphan_it)->next_iterator;
+			}
+		}
+
 		template<class OtherTraits>
 		void reparentPtr(NodePtr node, TreeValue<OtherTraits>& other) noexcept {
 			IteratorBase** orphan_it = &other.proxy->first;
@@ -406,8 +875,10 @@ namespace mylib {
 			right_child->parent = node->parent;
 			node->parent = right_child;
 
-			node->height = node->right->height + 1;
-			right_child->height = node->height + 1;
+			node->height = std::max(node->left->height, node->right->height) + 1;
+			right_child->height = std::max(node->height, right_child->right->height) + 1;
+			Augment::update(node);
+			Augment::update(right_child);
 		}
 
 		void rightRotate(NodePtr node) noexcept {
@@ -423,8 +894,374 @@ namespace mylib {
 			left_child->parent = node->parent;
 			node->parent = left_child;
 
-			node->height = node->left->height + 1;
-			left_child->height = node->height + 1;
+			node->height = std::max(node->left->height, node->right->height) + 1;
+			left_child->height = std::max(left_child->left->height, node->height) + 1;
+			Augment::update(node);
+			Augment::update(left_child);
+		}
+
+		// Join and split work on detached subtrees whose nil links all point to head. Unlike leftRotate and rightRotate
+		// they never touch head, so disjoint subtrees can be processed on different threads.
+		static void updateNode(NodePtr node) noexcept {
+			node->height = std::max(node->left->height, node->right->height) + 1;
+			Augment::update(node);
+		}
+
+		static void linkNode(NodePtr node, NodePtr left, NodePtr right) noexcept {
+			node->left	= left;
+			node->right = right;
+			if (!left->is_nil) left->parent = node;
+			if (!right->is_nil) right->parent = node;
+			updateNode(node);
+		}
+
+		[[nodiscard]] static NodePtr rotateLeftSubtree(NodePtr node) noexcept {
+			const NodePtr right_child = node->right;
+			node->right = right_child->left;
+			if (!node->right->is_nil) node->right->parent = node;
+			right_child->left	= node;
+			node->parent		= right_child;
+			updateNode(node);
+			updateNode(right_child);
+			return right_child;
+		}
+
+		[[nodiscard]] static NodePtr rotateRightSubtree(NodePtr node) noexcept {
+			const NodePtr left_child = node->left;
+			node->left = left_child->right;
+			if (!node->left->is_nil) node->left->parent = node;
+			left_child->right	= node;
+			node->parent		= left_child;
+			updateNode(node);
+			updateNode(left_child);
+			return left_child;
+		}
+
+		// Returns the root of a balanced tree holding left, pivot and right, where every key of left is less than the key
+		// of pivot and every key of right is greater. Takes O(|height(left) - height(right)|).
+		[[nodiscard]] static NodePtr joinSubtrees(NodePtr left, NodePtr pivot, NodePtr right) noexcept {
+			if (left->height > right->height + 1) return joinRightSpine(left, pivot, right);
+			if (right->height > left->height + 1) return joinLeftSpine(left, pivot, right);
+			linkNode(pivot, left, right);
+			return pivot;
+		}
+
+		[[nodiscard]] static NodePtr joinRightSpine(NodePtr left, NodePtr pivot, NodePtr right) noexcept {
+			const NodePtr left_left		= left->left;
+			const NodePtr left_right	= left->right;
+
+			if (left_right->height <= right->height + 1) {
+				linkNode(pivot, left_right, right);
+				if (pivot->height <= left_left->height + 1) {
+					linkNode(left, left_left, pivot);
+					return left;
+				}
+				linkNode(left, left_left, rotateRightSubtree(pivot));
+				return rotateLeftSubtree(left);
+			}
+
+			const NodePtr joined = joinRightSpine(left_right, pivot, right);
+			linkNode(left, left_left, joined);
+			return joined->height <= left_left->height + 1 ? left : rotateLeftSubtree(left);
+		}
+
+		[[nodiscard]] static NodePtr joinLeftSpine(NodePtr left, NodePtr pivot, NodePtr right) noexcept {
+			const NodePtr right_left	= right->left;
+			const NodePtr right_right	= right->right;
+
+			if (right_left->height <= left->height + 1) {
+				linkNode(pivot, left, right_left);
+				if (pivot->height <= right_right->height + 1) {
+					linkNode(right, pivot, right_right);
+					return right;
+				}
+				linkNode(right, rotateLeftSubtree(pivot), right_right);
+				return rotateRightSubtree(right);
+			}
+
+			const NodePtr joined = joinLeftSpine(left, pivot, right_left);
+			linkNode(right, joined, right_right);
+			return joined->height <= right_right->height + 1 ? right : rotateRightSubtree(right);
+		}
+
+		// Joins two subtrees where every key of left is less than every key of right.
+		[[nodiscard]] NodePtr joinSubtrees(NodePtr left, NodePtr right) const noexcept {
+			if (left->is_nil) return right;
+			if (right->is_nil) return left;
+			NodePtr max_node;
+			const NodePtr rest = removeMaxFromSubtree(left, max_node);
+			return joinSubtrees(rest, max_node, right);
+		}
+
+		[[nodiscard]] static NodePtr removeMaxFromSubtree(NodePtr root, NodePtr& max_node) noexcept {
+			if (root->right->is_nil) {
+				max_node = root;
+				return root->left;
+			}
+			const NodePtr rest = removeMaxFromSubtree(root->right, max_node);
+			return joinSubtrees(root->left, root, rest);
+		}
+
+		// Splits a subtree into the keys less than key and the keys greater than it. Returns the node with an equal key,
+		// or head when there is none.
+		[[nodiscard]] NodePtr splitSubtree(NodePtr root, const key_type& key, NodePtr& left, NodePtr& right) const noexcept {
+			if (root->is_nil) {
+				left = right = head;
+				return head;
+			}
+
+			const NodePtr root_left		= root->left;
+			const NodePtr root_right	= root->right;
+
+			if (comp(key, Traits::getKeyFromValue(root->value))) {
+				NodePtr right_part;
+				const NodePtr found = splitSubtree(root_left, key, left, right_part);
+				right = joinSubtrees(right_part, root, root_right);
+				return found;
+			}
+			if (comp(Traits::getKeyFromValue(root->value), key)) {
+				NodePtr left_part;
+				const NodePtr found = splitSubtree(root_right, key, left_part, right);
+				left = joinSubtrees(root_left, root, left_part);
+				return found;
+			}
+			left	= root_left;
+			right	= root_right;
+			return root;
+		}
+
+		[[nodiscard]] NodePtr detachNode(NodePtr node) const noexcept {
+			node->left	= head;
+			node->right = head;
+			return node;
+		}
+
+		static const std::size_t parallel_height = 12; // subtrees of about 2^12 nodes and more are worth a thread
+
+		template<class LeftFn, class RightFn>
+		static void forkJoin(unsigned thread_count, std::size_t height, TreeDiscarded<NodePtr>& discarded, LeftFn&& left_fn, RightFn&& right_fn) {
+			if (thread_count < 2 || height < parallel_height) {
+				left_fn(thread_count, discarded);
+				right_fn(thread_count, discarded);
+				return;
+			}
+
+			TreeDiscarded<NodePtr> left_discarded;
+			parallelInvoke([&]() { left_fn(thread_count / 2, left_discarded); }, [&]() { right_fn(thread_count - thread_count / 2, discarded); });
+			discarded.append(left_discarded);
+		}
+
+		// The set operations keep the values of first for equal keys. They split the second tree at the root of the first
+		// one and recurse on both halves, which costs O(m log(n / m + 1)) for trees of sizes m <= n.
+		NodePtr unionSubtrees(NodePtr first, NodePtr second, unsigned thread_count, TreeDiscarded<NodePtr>& discarded) {
+			if (first->is_nil) return second;
+			if (second->is_nil) return first;
+
+			NodePtr second_left, second_right;
+			const NodePtr found = splitSubtree(second, Traits::getKeyFromValue(first->value), second_left, second_right);
+			if (!found->is_nil) discarded.push(detachNode(found));
+
+			const NodePtr first_left	= first->left;
+			const NodePtr first_right	= first->right;
+			NodePtr left, right;
+			forkJoin(thread_count, std::min(first->height, second->height), discarded,
+				[&](unsigned threads, TreeDiscarded<NodePtr>& part) { left = unionSubtrees(first_left, second_left, threads, part); },
+				[&](unsigned threads, TreeDiscarded<NodePtr>& part) { right = unionSubtrees(first_right, second_right, threads, part); });
+			return joinSubtrees(left, first, right);
+		}
+
+		NodePtr intersectSubtrees(NodePtr first, NodePtr second, unsigned thread_count, TreeDiscarded<NodePtr>& discarded) {
+			if (first->is_nil || second->is_nil) {
+				discarded.push(first);
+				discarded.push(second);
+				return head;
+			}
+
+			NodePtr second_left, second_right;
+			const NodePtr found = splitSubtree(second, Traits::getKeyFromValue(first->value), second_left, second_right);
+
+			const NodePtr first_left	= first->left;
+			const NodePtr first_right	= first->right;
+			NodePtr left, right;
+			forkJoin(thread_count, std::min(first->height, second->height), discarded,
+				[&](unsigned threads, TreeDiscarded<NodePtr>& part) { left = intersectSubtrees(first_left, second_left, threads, part); },
+				[&](unsigned threads, TreeDiscarded<NodePtr>& part) { right = intersectSubtrees(first_right, second_right, threads, part); });
+
+			if (!found->is_nil) {
+				discarded.push(detachNode(found));
+				return joinSubtrees(left, first, right);
+			}
+			discarded.push(detachNode(first));
+			return joinSubtrees(left, right);
+		}
+
+		NodePtr subtractSubtrees(NodePtr first, NodePtr second, unsigned thread_count, TreeDiscarded<NodePtr>& discarded) {
+			if (first->is_nil || second->is_nil) {
+				discarded.push(second);
+				return first;
+			}
+
+			NodePtr first_left, first_right;
+			const NodePtr found = splitSubtree(first, Traits::getKeyFromValue(second->value), first_left, first_right);
+
+			const NodePtr second_left	= second->left;
+			const NodePtr second_right	= second->right;
+			NodePtr left, right;
+			forkJoin(thread_count, std::min(first->height, second->height), discarded,
+				[&](unsigned threads, TreeDiscarded<NodePtr>& part) { left = subtractSubtrees(first_left, second_left, threads, part); },
+				[&](unsigned threads, TreeDiscarded<NodePtr>& part) { right = subtractSubtrees(first_right, second_right, threads, part); });
+
+			discarded.push(detachNode(second));
+			if (!found->is_nil) discarded.push(detachNode(found));
+			return joinSubtrees(left, right);
+		}
+
+		void retargetNil(NodePtr node, NodePtr nil) noexcept {
+			if (node->is_nil) return;
+			if (node->left->is_nil) node->left = nil;
+			else retargetNil(node->left, nil);
+			if (node->right->is_nil) node->right = nil;
+			else retargetNil(node->right, nil);
+		}
+
+		void replaceHeadInIterators(NodePtr old_head) noexcept {
+			for (IteratorBase* it = proxy->first; it; it = it->next_iterator) {
+				uncheked_iterator* iterator = static_cast<uncheked_iterator*>(it);
+				if (iterator->ptr == old_head) iterator->ptr = head;
+			}
+		}
+
+		static size_type markDiscarded(NodePtr node) noexcept { // discarded nodes are told apart from linked ones by a zero height
+			if (node->is_nil) return 0;
+			node->height = 0;
+			return markDiscarded(node->left) + markDiscarded(node->right) + 1;
+		}
+
+		void freeSubtree(NodePtr node) noexcept {
+			freeNodes(alloc, node, 1);
+		}
+
+		// Frees the subtrees on both sides of a node on their own threads while they are large enough, so alloc has
+		// to be safe to use concurrently when thread_count is above one
+		static void freeNodes(Alloc& alloc, NodePtr node, unsigned thread_count) noexcept {
+			if (node->is_nil) return;
+			if (thread_count < 2 || node->height < parallel_height) {
+				freeNodes(alloc, node->left, 1);
+				freeNodes(alloc, node->right, 1);
+			}
+			else {
+				parallelInvoke([&]() { freeNodes(alloc, node->left, thread_count / 2); },
+							   [&]() { freeNodes(alloc, node->right, thread_count - thread_count / 2); });
+			}
+			Node::freeNode(alloc, node);
+		}
+
+		// Orphans iterators to discarded nodes and moves the iterators of other that point to linked nodes over here.
+		void reparentCombined(TreeValue& other) noexcept {
+			IteratorBase** orphan_it = &proxy->first;
+			while (*orphan_it) {
+				const NodePtr ptr = static_cast<uncheked_iterator*>(*orphan_it)->ptr;
+				if (!ptr->is_nil && !ptr->height) {
+					(*orphan_it)->proxy = nullptr;
+					*orphan_it = (*orphan_it)->next_iterator;
+				}
+				else orphan_it = &(*orphan_it)->next_iterator;
+			}
+
+			orphan_it = &other.proxy->first;
+			while (*orphan_it) {
+				const NodePtr ptr = static_cast<uncheked_iterator*>(*orphan_it)->ptr;
+				if (ptr->is_nil) {
+					orphan_it = &(*orphan_it)->next_iterator;
+					continue;
+				}
+
+				IteratorBase* next_iterator = (*orphan_it)->next_iterator;
+				if (ptr->height) {
+					(*orphan_it)->proxy = proxy;
+					(*orphan_it)->next_iterator = proxy->first;
+					proxy->first = *orphan_it;
+				}
+				else (*orphan_it)->proxy = nullptr;
+				*orphan_it = next_iterator;
+			}
+		}
+
+		[[nodiscard]] NodePtr selectNode(size_type index) const noexcept {
+			static_assert(std::is_base_of_v<TreeSubtreeSize, typename Augment::NodeData>, "Subtree sizes are not kept, use TreeOrderStatistics");
+			if (index >= size) return head;
+
+			NodePtr node = head->parent;
+			while (true) {
+				const size_type left_size = node->left->subtree_size;
+				if (index < left_size) node = node->left;
+				else if (index == left_size) return node;
+				else {
+					index -= left_size + 1;
+					node = node->right;
+				}
+			}
+		}
+
+		[[nodiscard]] size_type indexOf(NodePtr node) const noexcept {
+			static_assert(std::is_base_of_v<TreeSubtreeSize, typename Augment::NodeData>, "Subtree sizes are not kept, use TreeOrderStatistics");
+			if (node->is_nil) return size;
+
+			size_type index = node->left->subtree_size;
+			for (; !node->parent->is_nil; node = node->parent) {
+				if (node->parent->right == node) index += node->parent->left->subtree_size + 1;
+			}
+			return index;
+		}
+
+		template<class K>
+		[[nodiscard]] size_type rankOf(const K& key) const noexcept {
+			static_assert(std::is_base_of_v<TreeSubtreeSize, typename Augment::NodeData>, "Subtree sizes are not kept, use TreeOrderStatistics");
+			size_type rank = 0;
+			NodePtr node = head->parent;
+			while (!node->is_nil) {
+				if (comp(Traits::getKeyFromValue(node->value), key)) {
+					rank += node->left->subtree_size + 1;
+					node = node->right;
+				}
+				else node = node->left;
+			}
+			return rank;
+		}
+
+		template<class K>
+		[[nodiscard]] auto rangeAggregateOf(const K& first_key, const K& last_key) const {
+			using Monoid = typename Augment::monoid_type;
+
+			NodePtr node = head->parent;
+			while (!node->is_nil) { // the highest node within the range splits it into two paths
+				if (comp(Traits::getKeyFromValue(node->value), first_key)) node = node->right;
+				else if (!comp(Traits::getKeyFromValue(node->value), last_key)) node = node->left;
+				else break;
+			}
+			if (node->is_nil) return Monoid::identity();
+
+			typename Monoid::aggregate_type left_part = Monoid::identity();
+			for (NodePtr ptr = node->left; !ptr->is_nil;) {
+				if (comp(Traits::getKeyFromValue(ptr->value), first_key)) ptr = ptr->right;
+				else {
+					if (!ptr->right->is_nil) left_part = Monoid::combine(ptr->right->aggregate, left_part);
+					left_part = Monoid::combine(Monoid::lift(ptr->value), left_part);
+					ptr = ptr->left;
+				}
+			}
+
+			typename Monoid::aggregate_type right_part = Monoid::identity();
+			for (NodePtr ptr = node->right; !ptr->is_nil;) {
+				if (!comp(Traits::getKeyFromValue(ptr->value), last_key)) ptr = ptr->left;
+				else {
+					if (!ptr->left->is_nil) right_part = Monoid::combine(right_part, ptr->left->aggregate);
+					right_part = Monoid::combine(right_part, Monoid::lift(ptr->value));
+					ptr = ptr->right;
+				}
+			}
+
+			return Monoid::combine(Monoid::combine(left_part, Monoid::lift(node->value)), right_part);
 		}
 
 		key_compare comp;
@@ -442,13 +1279,19 @@ namespace mylib {
 		using key_compare		= typename Traits::key_compare;
 
 	protected:
-		using Node				= TreeNode<value_type, typename std::allocator_traits<allocator_type>::void_pointer>;
+		using Augment			= typename Traits::augment_type;
+		using Node				= TreeNode<value_type, typename std::allocator_traits<allocator_type>::void_pointer, typename Augment::NodeData, TreeHasInOrderLinks<Augment>::value>;
 		using Alloc				= typename std::allocator_traits<allocator_type>::template rebind_alloc<Node>;
 		using AllocTraits		= std::allocator_traits<Alloc>;
 		using NodePtr			= typename AllocTraits::pointer;
 		using TreeValue			= TreeValue<Traits>;
 		using uncheked_iterator = TreeUncheckedIterator<TreeValue>;
 
+		static constexpr bool multi_keys = Traits::multi_keys;
+
+		template<class OtherTraits>
+		friend class Tree; // merge takes nodes from a tree with other traits, e.g. a MultiMap into a Map
+
 	public:
 		using size_type			= typename AllocTraits::size_type;
 		using difference_type	= typename AllocTraits::difference_type;
@@ -467,10 +1310,42 @@ namespace mylib {
 		template<class AnyAllocator>
 		Tree(const Tree& other, AnyAllocator&& alloc) : tree_value(other.tree_value.comp, std::forward<AnyAllocator>(alloc)) {
 			createEmptyTree();
-			copyOrMoveAllNodes(other, CopyTag{});
+			try {
+				copyOrMoveAllNodes(other, CopyTag{});
+			}
+			catch (...) {
+				tidy();
+				throw;
+			}
+
 			tree_value.size = other.tree_value.size;
 		}
 
+		// Copies other on up to thread_count threads, cloning the subtrees on both sides of a node in parallel while they are
+		// large enough. The allocator and the copy constructor of the values must be safe to call concurrently then.
+		template<class AnyAllocator>
+		Tree(const Tree& other, AnyAllocator&& alloc, unsigned thread_count) : tree_value(other.tree_value.comp, std::forward<AnyAllocator>(alloc)) {
+			createEmptyTree();
+			const NodePtr other_root = other.tree_value.head->parent;
+			if (other_root->is_nil) return;
+
+			NodePtr root;
+			try {
+				root = cloneSubtree(other_root, thread_count);
+			}
+			catch (...) {
+				tidy();
+				throw;
+			}
+
+			root->parent				= tree_value.head;
+			tree_value.head->parent		= root;
+			tree_value.head->left		= tree_value.minInSubTree(root);
+			tree_value.head->right		= tree_value.maxInSubTree(root);
+			tree_value.size				= other.tree_value.size;
+			tree_value.relinkInOrder();
+		}
+
 		template<class AnyAllocator>
 		Tree(Tree&& other, AnyAllocator&& alloc) : tree_value(other.tree_value.comp, std::forward<AnyAllocator>(alloc)) {
 			if constexpr (!AllocTraits::is_always_equal::value) {
@@ -505,9 +1380,11 @@ namespace mylib {
 				}
 			}
 
-			clear();
-			copyOrMoveAllNodes(other, CopyTag{}); 
-			tree_value.size = other.tree_value.size; 
+			{
+				TreeReuseCache<TreeValue> reuse(tree_value);
+				cloneNodes(other, [&reuse](NodePtr node) { return reuse.reuseOrCreate(node->value); });
+			}
+			tree_value.size = other.tree_value.size;
 			return *this;
 		}
 
@@ -552,9 +1429,9 @@ namespace mylib {
 			static_assert(std::is_same_v<NodePtr, typename Tree<OtherTraits>::NodePtr>, "Different node types");
 			assert(tree_value.alloc == other.tree_value.alloc && "Different allocator types");
 
-			if (this == &other) return;
+			if (static_cast<const void*>(this) == &other) return;
 
-			uncheked_iterator it(&(other.tree_value), other.tree_value.head->left);
+			typename Tree<OtherTraits>::uncheked_iterator it(&(other.tree_value), other.tree_value.head->left);
 			while (!it.ptr->is_nil) {
 				NodePtr node_for_insertion = it.ptr;
 				++it;
@@ -579,18 +1456,135 @@ namespace mylib {
 			merge(other);
 		}
 
+		// The set operations leave other empty: its nodes are moved into this tree when they belong to the result and
+		// destroyed otherwise, and for keys present in both trees the value of this tree is kept. With thread_count above
+		// one large subtrees are processed in parallel, so the comparator must be safe to call concurrently.
+		void setUnion(Tree& other, unsigned thread_count = 1) {
+			if (this == &other) return;
+			combine(other, thread_count, [this](NodePtr first, NodePtr second, unsigned threads, TreeDiscarded<NodePtr>& discarded) {
+				return tree_value.unionSubtrees(first, second, threads, discarded);
+			});
+		}
+
+		void setUnion(Tree&& other, unsigned thread_count = 1) {
+			setUnion(other, thread_count);
+		}
+
+		void setIntersection(Tree& other, unsigned thread_count = 1) {
+			if (this == &other) return;
+			combine(other, thread_count, [this](NodePtr first, NodePtr second, unsigned threads, TreeDiscarded<NodePtr>& discarded) {
+				return tree_value.intersectSubtrees(first, second, threads, discarded);
+			});
+		}
+
+		void setIntersection(Tree&& other, unsigned thread_count = 1) {
+			setIntersection(other, thread_count);
+		}
+
+		void setDifference(Tree& other, unsigned thread_count = 1) {
+			if (this == &other) {
+				clear();
+				return;
+			}
+			combine(other, thread_count, [this](NodePtr first, NodePtr second, unsigned threads, TreeDiscarded<NodePtr>& discarded) {
+				return tree_value.subtractSubtrees(first, second, threads, discarded);
+			});
+		}
+
+		void setDifference(Tree&& other, unsigned thread_count = 1) {
+			setDifference(other, thread_count);
+		}
+
+		template<class Operation>
+		void combine(Tree& other, unsigned thread_count, Operation operation) {
+			static_assert(!multi_keys, "Set operations need unique keys");
+
+			if constexpr (!AllocTraits::is_always_equal::value) {
+				if (tree_value.alloc != other.tree_value.alloc) {
+					Tree moved(std::move(other), tree_value.alloc);
+					combine(moved, thread_count, operation);
+					return;
+				}
+			}
+
+			NodePtr root				= tree_value.head->parent;
+			const NodePtr other_root	= other.tree_value.head->parent;
+			const size_type total_size	= tree_value.size + other.tree_value.size;
+
+			if (tree_value.size < other.tree_value.size) { // only the nil links of the smaller tree are retargeted, so the trees swap heads
+				tree_value.retargetNil(root, other.tree_value.head);
+				const NodePtr old_head	= tree_value.head;
+				tree_value.head			= other.tree_value.head;
+				other.tree_value.head	= old_head;
+				tree_value.replaceHeadInIterators(old_head);
+				other.tree_value.replaceHeadInIterators(tree_value.head);
+			}
+			else other.tree_value.retargetNil(other_root, tree_value.head);
+
+			other.tree_value.head->left		= other.tree_value.head;
+			other.tree_value.head->parent	= other.tree_value.head;
+			other.tree_value.head->right	= other.tree_value.head;
+			other.tree_value.size			= 0;
+			other.tree_value.relinkInOrder();
+
+			TreeDiscarded<NodePtr> discarded;
+			root = operation(root, other_root, thread_count, discarded);
+
+			size_type discarded_size = 0;
+			for (NodePtr subtree = discarded.first; subtree; subtree = subtree->parent) {
+				discarded_size += tree_value.markDiscarded(subtree);
+			}
+			tree_value.reparentCombined(other.tree_value);
+			while (discarded.first) {
+				tree_value.freeSubtree(std::exchange(discarded.first, discarded.first->parent));
+			}
+
+			tree_value.size = total_size - discarded_size;
+			if (root->is_nil) {
+				tree_value.head->left	= tree_value.head;
+				tree_value.head->parent = tree_value.head;
+				tree_value.head->right	= tree_value.head;
+			}
+			else {
+				root->parent				= tree_value.head;
+				tree_value.head->parent		= root;
+				tree_value.head->left		= tree_value.minInSubTree(root);
+				tree_value.head->right		= tree_value.maxInSubTree(root);
+			}
+			tree_value.relinkInOrder();
+		}
+
 		~Tree() {
 			tidy();
 		}
 
 		template<class Tag>
 		void copyOrMoveAllNodes(const Tree& other, Tag tag) {
+			cloneNodes(other, [this, tag](NodePtr node) { return copyOrMoveNode(node, tag); });
+		}
+
+		// Rebuilds the shape of other in this empty tree out of the nodes that make_node returns for its nodes. Every
+		// node is linked as soon as it is made, so a throwing make_node leaves a tree that clear() can take apart.
+		template<class MakeNode>
+		void cloneNodes(const Tree& other, MakeNode make_node) {
 			if (other.tree_value.head->parent->is_nil) return;
 
+			try {
+				cloneNodes_(other, make_node);
+			}
+			catch (...) {
+				clear();
+				throw;
+			}
+		}
+
+		template<class MakeNode>
+		void cloneNodes_(const Tree& other, MakeNode& make_node) {
+
 			NodePtr ptr = other.tree_value.head->parent;
 
-			tree_value.head->parent			= copyOrMoveNode(ptr, tag);
-			tree_value.head->parent->height = ptr->height;
+			tree_value.head->parent			= make_node(ptr);
+			tree_value.copyShape(tree_value.head->parent, ptr);
 
 			NodeID<NodePtr> location{ tree_value.head->parent, NodeChild::left };
 			if (!ptr->left->is_nil) ptr = ptr->left;
@@ -601,13 +1595,13 @@ namespace mylib {
 			
 			while (!ptr->parent->is_nil) {
 				if (location.child == NodeChild::left) {
-					location.parent->left			= copyOrMoveNode(ptr, tag);
-					location.parent->left->height	= ptr->height;
+					location.parent->left			= make_node(ptr);
+					tree_value.copyShape(location.parent->left, ptr);
 					location.parent->left->parent	= location.parent;
 				}
 				else {
-					location.parent->right			= copyOrMoveNode(ptr, tag);
-					location.parent->right->height	= ptr->height;
+					location.parent->right			= make_node(ptr);
+					tree_value.copyShape(location.parent->right, ptr);
 					location.parent->right->parent	= location.parent;
 				}
 
@@ -624,7 +1618,7 @@ namespace mylib {
 					ptr				= ptr->right;
 				}
 				else {
-					while (ptr->parent->right == ptr || ptr->parent->right->is_nil) {
+					while (!ptr->parent->is_nil && (ptr->parent->right == ptr || ptr->parent->right->is_nil)) {
 						location.parent = location.parent->parent;
 						ptr				= ptr->parent;
 					}
@@ -637,6 +1631,36 @@ namespace mylib {
 
 			tree_value.head->left	= tree_value.minInSubTree(tree_value.head->parent);
 			tree_value.head->right	= tree_value.maxInSubTree(tree_value.head->parent);
+			tree_value.relinkInOrder();
+		}
+
+		NodePtr cloneSubtree(NodePtr source, unsigned thread_count) {
+			const NodePtr node = copyOrMoveNode(source, CopyTag{});
+			tree_value.copyShape(node, source);
+
+			const auto clone_left = [this, node, source](unsigned threads) {
+				if (source->left->is_nil) return;
+				node->left			= cloneSubtree(source->left, threads);
+				node->left->parent	= node;
+			};
+			const auto clone_right = [this, node, source](unsigned threads) {
+				if (source->right->is_nil) return;
+				node->right			= cloneSubtree(source->right, threads);
+				node->right->parent = node;
+			};
+
+			try {
+				if (thread_count < 2 || source->height < TreeValue::parallel_height) {
+					clone_left(1);
+					clone_right(1);
+				}
+				else parallelInvoke([&]() { clone_left(thread_count / 2); }, [&]() { clone_right(thread_count - thread_count / 2); });
+			}
+			catch (...) {
+				tree_value.freeSubtree(node);
+				throw;
+			}
+			return node;
 		}
 
 		[[nodiscard]] NodePtr copyOrMoveNode(NodePtr copy_node, MoveTag) {
@@ -644,7 +1668,7 @@ namespace mylib {
 			if constexpr (std::is_same_v<value_type, const key_type>) {
 				return TreeTempNode(tree_value.alloc, tree_value.head, std::move(const_cast<key_type&>(copy_node->value))).release();
 			}
-			else return TreeTempNode(tree_value.alloc, tree_value.head, std::move(const_cast<std::pair<key_type, Traits::mapped_type>&>(copy_node->value))).release();
+			else return TreeTempNode(tree_value.alloc, tree_value.head, std::move(reinterpret_cast<std::pair<key_type, typename Traits::mapped_type>&>(copy_node->value))).release();
 		}
 
 		[[nodiscard]] NodePtr copyOrMoveNode(NodePtr copy_node, CopyTag) {
@@ -671,6 +1695,7 @@ namespace mylib {
 			tree_value.head->parent = tree_value.head;
 			tree_value.head->right	= tree_value.head;
 			tree_value.size			= 0;
+			tree_value.relinkInOrder();
 			
 			while (!ptr->is_nil) {
 				NodePtr erasing_node = ptr;
@@ -693,6 +1718,45 @@ namespace mylib {
 			}
 		}
 
+		// Frees the nodes on up to thread_count threads, see TreeValue::freeNodes
+		void clear(unsigned thread_count) {
+			const NodePtr root = tree_value.head->parent;
+			tree_value.orphanNonHead();
+			resetHead();
+			TreeValue::freeNodes(tree_value.alloc, root, thread_count);
+		}
+
+		// Detaches the nodes under a new head and frees them on a background thread, so that it returns at once. The
+		// thread works with a copy of the allocator, which has to stay usable after the tree is gone.
+		void clearInBackground() {
+			if (tree_value.head->parent->is_nil) return;
+
+			const NodePtr new_head = Node::createHeadNode(tree_value.alloc);
+			tree_value.orphanNonHead();
+			const NodePtr old_head = std::exchange(tree_value.head, new_head);
+			tree_value.replaceHeadInIterators(old_head);
+			tree_value.size = 0;
+
+			auto free_nodes = [alloc = tree_value.alloc, old_head]() mutable {
+				TreeValue::freeNodes(alloc, old_head->parent, 1);
+				Node::freeHeadNode(alloc, old_head);
+			};
+			try {
+				std::thread(free_nodes).detach();
+			}
+			catch (...) {
+				free_nodes();
+			}
+		}
+
+		void resetHead() noexcept {
+			tree_value.head->left	= tree_value.head;
+			tree_value.head->parent = tree_value.head;
+			tree_value.head->right	= tree_value.head;
+			tree_value.size			= 0;
+			tree_value.relinkInOrder();
+		}
+
 		void swapTreeValue(Tree& other) {
 			std::swap(tree_value.head, other.tree_value.head);
 			std::swap(tree_value.comp, other.tree_value.comp);
@@ -720,12 +1784,84 @@ namespace mylib {
 
 		template<class InputIt>
 		void insert(InputIt first, InputIt last) {
+			if (!tree_value.size) {
+				build(first, last);
+				return;
+			}
+
 			while (first != last) {
 				emplaceHint(tree_value.head, *first);
 				++first;
 			}
 		}
 
+		// Inserts [first, last) at once: the values are built into a tree of their own and united with this one, which
+		// walks both trees together and takes O(m log(n / m + 1)) for m values. Unsorted input is sorted on up to
+		// thread_count threads, and the union runs on as many, so the comparator must be safe to call concurrently. As with
+		// insert, keys already present keep their values, and the first of several equal keys in the batch is kept.
+		template<class InputIt>
+		void insertBatch(InputIt first, InputIt last, unsigned thread_count = 1) {
+			Tree batch(tree_value.comp, static_cast<allocator_type>(tree_value.alloc));
+			batch.build(first, last, thread_count);
+			if constexpr (multi_keys) merge(batch); // every node of the batch is kept, so there is nothing to unite
+			else setUnion(batch, thread_count);
+		}
+
+		// Fills an empty tree in linear time when the input is sorted: the nodes are created in input order, chained
+		// through their right links and then linked into a perfectly balanced tree. Unsorted input costs one sort of the
+		// node pointers. As with emplace, the first of several equal keys is kept, unless the tree keeps them all.
+		template<class InputIt>
+		void build(InputIt first, InputIt last, unsigned thread_count = 1) {
+			TreeTempChain<Alloc> chain(tree_value.alloc);
+			bool sorted = true;
+
+			for (; first != last; ++first) {
+				assert(maxSize() != chain.count && "The lack of memory error");
+				TreeTempNode tmp_node(tree_value.alloc, tree_value.head, *first);
+				if (chain.count && sorted && !tree_value.comp(Traits::getKeyFromValue(chain.last->value), Traits::getKeyFromValue(tmp_node.ptr->value))) {
+					if (!tree_value.comp(Traits::getKeyFromValue(tmp_node.ptr->value), Traits::getKeyFromValue(chain.last->value))) {
+						if constexpr (!multi_keys) continue;
+					}
+					else sorted = false;
+				}
+				chain.push(tmp_node.release());
+			}
+			if (!chain.count) return;
+
+			if (!sorted) {
+				std::vector<NodePtr> nodes;
+				nodes.reserve(chain.count);
+				for (NodePtr node = chain.first; nodes.size() != chain.count; node = node->right) {
+					nodes.push_back(node);
+				}
+
+				parallelStableSort(nodes.begin(), nodes.end(), thread_count, [this](NodePtr lhs, NodePtr rhs) {
+					return tree_value.comp(Traits::getKeyFromValue(lhs->value), Traits::getKeyFromValue(rhs->value));
+				});
+
+				std::size_t kept = multi_keys ? nodes.size() : 1; // the sort is stable, so equal keys keep their input order
+				for (std::size_t i = kept; i < nodes.size(); ++i) {
+					if (tree_value.comp(Traits::getKeyFromValue(nodes[kept - 1]->value), Traits::getKeyFromValue(nodes[i]->value))) {
+						std::swap(nodes[kept++], nodes[i]);
+					}
+				}
+
+				chain.release();
+				for (std::size_t i = 0; i < kept; ++i) chain.push(nodes[i]);
+				for (std::size_t i = kept; i < nodes.size(); ++i) Node::freeNode(tree_value.alloc, nodes[i]);
+			}
+
+			const size_type count = chain.count;
+			NodePtr node = chain.release();
+			NodePtr root = tree_value.linkBalanced(node, count);
+			root->parent				= tree_value.head;
+			tree_value.head->parent		= root;
+			tree_value.head->left		= tree_value.minInSubTree(root);
+			tree_value.head->right		= tree_value.maxInSubTree(root);
+			tree_value.size				= count;
+			tree_value.relinkInOrder();
+		}
+
 		void insert(std::initializer_list<value_type> init) {
 			insert(init.begin(), init.end());
 		}
@@ -742,11 +1878,13 @@ namespace mylib {
 			NodePtr node_for_insertion;
 			TreeFindResult<NodePtr> result;
 			if constexpr (KeyExtractor::extractable) {
-				const auto& key = KeyExtractor::extract(std::forward<Args>(args)...);
+				auto&& key = KeyExtractor::template extract<compares_views>(args...);
 				result = findPlaceForNode(key);
 				if (result.duplicate) return { result.location.parent, false };
 				checkGrow();
-				node_for_insertion = TreeTempNode(tree_value.alloc, tree_value.head, std::forward<Args>(args)...).release();
+				node_for_insertion = makeWithLookupKey<KeyExtractor>(std::forward<decltype(key)>(key), [this](auto&&... value_args) {
+					return TreeTempNode(tree_value.alloc, tree_value.head, std::forward<decltype(value_args)>(value_args)...).release();
+				}, std::forward<Args>(args)...);
 			}
 			else {
 				checkGrow();
@@ -772,11 +1910,13 @@ namespace mylib {
 			TreeFindResult<NodePtr> result;
 
 			if constexpr (KeyExtractor::extractable) {
-				const auto& key = KeyExtractor::extract(std::forward<Args>(args)...);
+				auto&& key = KeyExtractor::template extract<compares_views>(args...);
 				result = findPlaceForNodeWithHint(hint, key);
 				if (result.duplicate) return result.location.parent;
 				checkGrow();
-				node_for_insertion = TreeTempNode(tree_value.alloc, tree_value.head, std::forward<Args>(args)...).release();
+				node_for_insertion = makeWithLookupKey<KeyExtractor>(std::forward<decltype(key)>(key), [this](auto&&... value_args) {
+					return TreeTempNode(tree_value.alloc, tree_value.head, std::forward<decltype(value_args)>(value_args)...).release();
+				}, std::forward<Args>(args)...);
 			}
 			else {
 				checkGrow();
@@ -790,35 +1930,379 @@ namespace mylib {
 		}
 
 		size_type count(const key_type& key) const noexcept {
-			TreeFindResult<NodePtr> result = findPlaceForNode(key);
-			return result.duplicate ? size_type{ 1 } : size_type{ 0 };
+			if constexpr (multi_keys) {
+				const std::pair<NodePtr, NodePtr> range = equalRangeNodes(key);
+				size_type result = 0;
+				for (NodePtr node = range.first; node != range.second; node = tree_value.nextNode(node)) ++result;
+				return result;
+			}
+			else {
+				TreeFindResult<NodePtr> result = findPlaceForNode(key);
+				return result.duplicate ? size_type{ 1 } : size_type{ 0 };
+			}
 		}
 
 		iterator find(const key_type& key) noexcept {
-			TreeFindResult<NodePtr> result = findPlaceForNode(key);
-			return result.duplicate ? iterator{ &tree_value, result.location.parent } : end();
+			if constexpr (multi_keys) return iterator{ &tree_value, findFirstNode(key) };
+			else {
+				TreeFindResult<NodePtr> result = findPlaceForNode(key);
+				return result.duplicate ? iterator{ &tree_value, result.location.parent } : end();
+			}
 		}
 
 		const_iterator find(const key_type& key) const noexcept {
-			TreeFindResult<NodePtr> result = findPlaceForNode(key);
-			return result.duplicate ? const_iterator{ &tree_value, result.location.parent } : cend();
+			if constexpr (multi_keys) return const_iterator{ &tree_value, findFirstNode(key) };
+			else {
+				TreeFindResult<NodePtr> result = findPlaceForNode(key);
+				return result.duplicate ? const_iterator{ &tree_value, result.location.parent } : cend();
+			}
 		}
 
 		bool contains(const key_type& key) const noexcept {
-			TreeFindResult<NodePtr> result = findPlaceForNode(key);
-			return result.duplicate ? true : false;
+			if constexpr (multi_keys) return !findFirstNode(key)->is_nil;
+			else {
+				TreeFindResult<NodePtr> result = findPlaceForNode(key);
+				return result.duplicate ? true : false;
+			}
+		}
+
+		// Finds every key of [first, last) and writes a pointer to the value with the i-th key, or nullptr, to out[i].
+		// Up to group_size lookups descend the tree in turns, one level each, and the next node of a lookup is
+		// prefetched before the others take their turn, so the cache misses of independent lookups overlap instead of
+		// queueing. Pointers rather than iterators are written, as every iterator registers with the container.
+		template<class ForwardIt, class RandomIt>
+		void findMany(ForwardIt first, ForwardIt last, RandomIt out, size_type group_size = default_lookup_group) {
+			findManyNodes(first, last, group_size, [&out](size_type index, NodePtr node) {
+				out[index] = node->is_nil ? nullptr : std::addressof(node->value);
+			});
+		}
+
+		template<class ForwardIt, class RandomIt>
+		void findMany(ForwardIt first, ForwardIt last, RandomIt out, size_type group_size = default_lookup_group) const {
+			findManyNodes(first, last, group_size, [&out](size_type index, NodePtr node) {
+				out[index] = node->is_nil ? nullptr : static_cast<const value_type*>(std::addressof(node->value));
+			});
+		}
+
+		[[nodiscard]] iterator lowerBound(const key_type& key) noexcept {
+			return iterator(&tree_value, lowerBoundNode(key));
+		}
+
+		[[nodiscard]] const_iterator lowerBound(const key_type& key) const noexcept {
+			return const_iterator(&tree_value, lowerBoundNode(key));
+		}
+
+		template<class K, class Compare = key_compare, class = typename Compare::is_transparent>
+		[[nodiscard]] iterator lowerBound(const K& key) noexcept {
+			return iterator(&tree_value, lowerBoundNode(key));
+		}
+
+		template<class K, class Compare = key_compare, class = typename Compare::is_transparent>
+		[[nodiscard]] const_iterator lowerBound(const K& key) const noexcept {
+			return const_iterator(&tree_value, lowerBoundNode(key));
+		}
+
+		[[nodiscard]] iterator upperBound(const key_type& key) noexcept {
+			return iterator(&tree_value, upperBoundNode(key));
+		}
+
+		[[nodiscard]] const_iterator upperBound(const key_type& key) const noexcept {
+			return const_iterator(&tree_value, upperBoundNode(key));
+		}
+
+		template<class K, class Compare = key_compare, class = typename Compare::is_transparent>
+		[[nodiscard]] iterator upperBound(const K& key) noexcept {
+			return iterator(&tree_value, upperBoundNode(key));
+		}
+
+		template<class K, class Compare = key_compare, class = typename Compare::is_transparent>
+		[[nodiscard]] const_iterator upperBound(const K& key) const noexcept {
+			return const_iterator(&tree_value, upperBoundNode(key));
+		}
+
+		[[nodiscard]] std::pair<iterator, iterator> equalRange(const key_type& key) noexcept {
+			std::pair<NodePtr, NodePtr> result = equalRangeNodes(key);
+			return { iterator(&tree_value, result.first), iterator(&tree_value, result.second) };
+		}
+
+		[[nodiscard]] std::pair<const_iterator, const_iterator> equalRange(const key_type& key) const noexcept {
+			std::pair<NodePtr, NodePtr> result = equalRangeNodes(key);
+			return { const_iterator(&tree_value, result.first), const_iterator(&tree_value, result.second) };
+		}
+
+		template<class K, class Compare = key_compare, class = typename Compare::is_transparent>
+		[[nodiscard]] std::pair<iterator, iterator> equalRange(const K& key) noexcept {
+			std::pair<NodePtr, NodePtr> result = equalRangeNodes(key);
+			return { iterator(&tree_value, result.first), iterator(&tree_value, result.second) };
+		}
+
+		template<class K, class Compare = key_compare, class = typename Compare::is_transparent>
+		[[nodiscard]] std::pair<const_iterator, const_iterator> equalRange(const K& key) const noexcept {
+			std::pair<NodePtr, NodePtr> result = equalRangeNodes(key);
+			return { const_iterator(&tree_value, result.first), const_iterator(&tree_value, result.second) };
+		}
+
+		// Calls fn for every value with a key in [first_key, last_key) in ascending order. The tree is descended once
+		// and then walked node to node, so no iterators are created and registered on the way.
+		template<class Fn>
+		void forEachInRange(const key_type& first_key, const key_type& last_key, Fn fn) {
+			forEachInRange_(first_key, last_key, fn);
+		}
+
+		template<class Fn>
+		void forEachInRange(const key_type& first_key, const key_type& last_key, Fn fn) const {
+			forEachInRange_(first_key, last_key, [&fn](const value_type& value) { fn(value); });
 		}
 
-		[[nodiscard]] TreeFindResult<NodePtr> findPlaceForNode(const key_type& key) const noexcept {
+		template<class K, class Fn, class Compare = key_compare, class = typename Compare::is_transparent>
+		void forEachInRange(const K& first_key, const K& last_key, Fn fn) {
+			forEachInRange_(first_key, last_key, fn);
+		}
+
+		template<class K, class Fn, class Compare = key_compare, class = typename Compare::is_transparent>
+		void forEachInRange(const K& first_key, const K& last_key, Fn fn) const {
+			forEachInRange_(first_key, last_key, [&fn](const value_type& value) { fn(value); });
+		}
+
+		template<class K, class Fn>
+		void forEachInRange_(const K& first_key, const K& last_key, Fn&& fn) const {
+			NodePtr node = lowerBoundNode(first_key);
+			while (!node->is_nil && tree_value.comp(Traits::getKeyFromValue(node->value), last_key)) {
+				fn(node->value);
+				node = tree_value.nextNode(node);
+			}
+		}
+
+		// rank, select, distance and forEachParallel take O(log n) per call and need the subtree sizes kept by
+		// TreeOrderStatistics, see OrderStatisticMap.
+		[[nodiscard]] size_type rank(const key_type& key) const noexcept { // the number of keys less than key
+			return tree_value.rankOf(key);
+		}
+
+		template<class K, class Compare = key_compare, class = typename Compare::is_transparent>
+		[[nodiscard]] size_type rank(const K& key) const noexcept {
+			return tree_value.rankOf(key);
+		}
+
+		[[nodiscard]] iterator select(size_type index) noexcept {
+			return iterator(&tree_value, tree_value.selectNode(index));
+		}
+
+		[[nodiscard]] const_iterator select(size_type index) const noexcept {
+			return const_iterator(&tree_value, tree_value.selectNode(index));
+		}
+
+		[[nodiscard]] difference_type distance(const_iterator first, const_iterator last) const noexcept {
+			assert(first.getContainer() == &tree_value && last.getContainer() == &tree_value && "Iterator from another container");
+			return static_cast<difference_type>(tree_value.indexOf(last.ptr)) - static_cast<difference_type>(tree_value.indexOf(first.ptr));
+		}
+
+		// rangeAggregate, aggregate and refreshAggregate need an augment built by TreeAggregate, see AggregateMap.
+		[[nodiscard]] auto rangeAggregate(const key_type& first_key, const key_type& last_key) const { // over the keys in [first_key, last_key)
+			return tree_value.rangeAggregateOf(first_key, last_key);
+		}
+
+		template<class K, class Compare = key_compare, class = typename Compare::is_transparent>
+		[[nodiscard]] auto rangeAggregate(const K& first_key, const K& last_key) const {
+			return tree_value.rangeAggregateOf(first_key, last_key);
+		}
+
+		[[nodiscard]] auto aggregate() const {
+			using Monoid = typename Augment::monoid_type;
+			return tree_value.head->parent->is_nil ? Monoid::identity() : tree_value.head->parent->aggregate;
+		}
+
+		void refreshAggregate(const_iterator position) noexcept { // after the value at position was changed in place
+			assert(position.getContainer() == &tree_value && "Iterator from another container");
+			assert(!position.ptr->is_nil && "Iterator out of range");
+			tree_value.updateAugmentToRoot(position.ptr);
+		}
+
+		// Splits the values into thread_count runs of equal length and calls fn for each run on its own thread.
+		template<class Fn>
+		void forEachParallel(Fn fn, unsigned thread_count) {
+			forEachParallel_(fn, thread_count);
+		}
+
+		template<class Fn>
+		void forEachParallel(Fn fn, unsigned thread_count) const {
+			forEachParallel_([&fn](const value_type& value) { fn(value); }, thread_count);
+		}
+
+		template<class Fn>
+		void forEachParallel_(Fn&& fn, unsigned thread_count) const {
+			parallelFor(tree_value.size, thread_count, [&](std::size_t first, std::size_t last) {
+				NodePtr node = tree_value.selectNode(first);
+				for (; first != last; ++first, node = tree_value.nextNode(node)) fn(node->value);
+			});
+		}
+
+		template<class K>
+		[[nodiscard]] NodePtr lowerBoundNode(const K& key) const noexcept {
+			const std::uint64_t key_prefix = tree_value.keyPrefixOf(key);
+			NodePtr result = tree_value.head;
+			NodePtr try_node = tree_value.head->parent;
+			while (!try_node->is_nil) {
+				const int order = tree_value.template comparePrefix<K>(try_node, key_prefix);
+				if (order < 0 || (!order && tree_value.comp(Traits::getKeyFromValue(try_node->value), key))) try_node = try_node->right;
+				else {
+					result = try_node;
+					try_node = try_node->left;
+				}
+			}
+			return result;
+		}
+
+		template<class K>
+		[[nodiscard]] NodePtr upperBoundNode(const K& key) const noexcept {
+			const std::uint64_t key_prefix = tree_value.keyPrefixOf(key);
+			NodePtr result = tree_value.head;
+			NodePtr try_node = tree_value.head->parent;
+			while (!try_node->is_nil) {
+				const int order = tree_value.template comparePrefix<K>(try_node, key_prefix);
+				if (order > 0 || (!order && tree_value.comp(key, Traits::getKeyFromValue(try_node->value)))) {
+					result = try_node;
+					try_node = try_node->left;
+				}
+				else try_node = try_node->right;
+			}
+			return result;
+		}
+
+		template<class K>
+		[[nodiscard]] std::pair<NodePtr, NodePtr> equalRangeNodes(const K& key) const noexcept {
+			NodePtr lower = tree_value.head;
+			NodePtr upper = tree_value.head;
+			NodePtr try_node = tree_value.head->parent;
+
+			while (!try_node->is_nil) {
+				if (tree_value.comp(Traits::getKeyFromValue(try_node->value), key)) try_node = try_node->right;
+				else if (tree_value.comp(key, Traits::getKeyFromValue(try_node->value))) {
+					lower = upper = try_node;
+					try_node = try_node->left;
+				}
+				else { // the bounds split here: the lower one is in the left subtree, the upper one in the right
+					NodePtr left_node	= try_node->left;
+					NodePtr right_node	= try_node->right;
+					lower = try_node;
+
+					while (!left_node->is_nil) {
+						if (tree_value.comp(Traits::getKeyFromValue(left_node->value), key)) left_node = left_node->right;
+						else {
+							lower = left_node;
+							left_node = left_node->left;
+						}
+					}
+					while (!right_node->is_nil) {
+						if (tree_value.comp(key, Traits::getKeyFromValue(right_node->value))) {
+							upper = right_node;
+							right_node = right_node->left;
+						}
+						else right_node = right_node->right;
+					}
+					break;
+				}
+			}
+			return { lower, upper };
+		}
+
+		// Equal keys sit side by side, and the first of them is found
+		[[nodiscard]] NodePtr findFirstNode(const key_type& key) const noexcept {
+			const NodePtr node = lowerBoundNode(key);
+			return node->is_nil || tree_value.comp(key, Traits::getKeyFromValue(node->value)) ? tree_value.head : node;
+		}
+
+		static constexpr size_type default_lookup_group	= 16;
+		static constexpr size_type max_lookup_group		= 64;
+
+		template<class ForwardIt>
+		struct TreeLookup {
+			ForwardIt key;
+			NodePtr node;
+			size_type index;
+		};
+
+		// Calls fn(index, node) once per key, with the node holding it or head, in no particular order
+		template<class ForwardIt, class Fn>
+		void findManyNodes(ForwardIt first, ForwardIt last, size_type group_size, Fn fn) const {
+			assert(group_size != 0 && group_size <= max_lookup_group && "Lookup group size is out of range");
+
+			const NodePtr root = tree_value.head->parent;
+			TreeLookup<ForwardIt> lookups[max_lookup_group];
+			size_type active	= 0;
+			size_type started	= 0;
+
+			for (; active != group_size && first != last; ++active, ++first) {
+				lookups[active] = { first, root, started++ };
+			}
+			prefetchForRead(root);
+
+			while (active) {
+				for (size_type i = 0; i < active; ) {
+					TreeLookup<ForwardIt>& lookup = lookups[i];
+					const NodePtr node = lookup.node;
+					bool done = true;
+
+					if (node->is_nil) fn(lookup.index, node);
+					else if (tree_value.comp(Traits::getKeyFromValue(node->value), *lookup.key)) {
+						lookup.node = node->right;
+						done = false;
+					}
+					else if (tree_value.comp(*lookup.key, Traits::getKeyFromValue(node->value))) {
+						lookup.node = node->left;
+						done = false;
+					}
+					else fn(lookup.index, node);
+
+					if (!done) { // the child is not touched before this lookup's next turn
+						prefetchForRead(lookup.node);
+						++i;
+					}
+					else if (first != last) {
+						lookup = { first, root, started++ };
+						++first;
+						++i;
+					}
+					else lookup = lookups[--active];
+				}
+			}
+		}
+
+		// std::less of a string orders it against a view of another string as against the string itself, so emplace looks
+		// views of its arguments up through std::less<>
+		static constexpr bool compares_views = std::is_same_v<key_compare, std::less<key_type>>;
+
+		template<class K>
+		[[nodiscard]] decltype(auto) lookupComp() const noexcept {
+			if constexpr (compares_views && !std::is_same_v<K, key_type>) return std::less<>{};
+			else return (tree_value.comp);
+		}
+
+		// With multi_keys a key is never a duplicate: it goes after the keys equal to it, where its upper bound is
+		template<class K>
+		[[nodiscard]] TreeFindResult<NodePtr> findPlaceForNode(const K& key) const noexcept {
+			const auto& comp = lookupComp<K>();
+			const std::uint64_t key_prefix = tree_value.keyPrefixOf(key);
 			TreeFindResult<NodePtr> result{ {tree_value.head->parent, NodeChild::right}, false };
 			NodePtr try_node = tree_value.head->parent;
 			while (!try_node->is_nil) {
 				result.location.parent = try_node;
-				if (tree_value.comp(Traits::getKeyFromValue(try_node->value), key)) {
+				const int order = tree_value.template comparePrefix<K>(try_node, key_prefix);
+				if constexpr (multi_keys) {
+					if (order > 0 || (!order && comp(key, Traits::getKeyFromValue(try_node->value)))) {
+						result.location.child = NodeChild::left;
+						try_node = try_node->left;
+					}
+					else {
+						result.location.child = NodeChild::right;
+						try_node = try_node->right;
+					}
+				}
+				else if (order < 0 || (!order && comp(Traits::getKeyFromValue(try_node->value), key))) {
 					result.location.child = NodeChild::right;
 					try_node = try_node->right;
 				}
-				else if (tree_value.comp(key, Traits::getKeyFromValue(try_node->value))) {
+				else if (order > 0 || comp(key, Traits::getKeyFromValue(try_node->value))) {
 					result.location.child = NodeChild::left;
 					try_node = try_node->left;
 				}
@@ -830,27 +2314,48 @@ namespace mylib {
 			return result;
 		}
 
-		[[nodiscard]] TreeFindResult<NodePtr> findPlaceForNodeWithHint(NodePtr hint, const key_type& key) noexcept {
+		// With multi_keys the key goes right before hint if the order allows, and after its equal keys otherwise
+		template<class K>
+		[[nodiscard]] TreeFindResult<NodePtr> findPlaceForNodeWithHint(NodePtr hint, const K& key) noexcept {
+			const auto& comp = lookupComp<K>();
+			if constexpr (multi_keys) {
+				if (hint == tree_value.head) {
+					if (hint->right->is_nil || !comp(key, Traits::getKeyFromValue(tree_value.head->right->value))) {
+						return { {tree_value.head->right, NodeChild::right}, false };
+					}
+				}
+				else if (!comp(Traits::getKeyFromValue(hint->value), key)) {
+					if (hint == tree_value.head->left) return { {hint, NodeChild::left}, false };
+
+					NodePtr prev = (--(uncheked_iterator(&tree_value, hint))).ptr;
+					if (!comp(key, Traits::getKeyFromValue(prev->value))) {
+						if (prev->right->is_nil) return { {prev, NodeChild::right}, false };
+						else return { {hint, NodeChild::left}, false };
+					}
+				}
+				return findPlaceForNode(key);
+			}
+
 			if (hint == tree_value.head) {
-				if (hint->right->is_nil || tree_value.comp(Traits::getKeyFromValue(tree_value.head->right->value), key)) {
+				if (hint->right->is_nil || comp(Traits::getKeyFromValue(tree_value.head->right->value), key)) {
 					return { {tree_value.head->right, NodeChild::right}, false };
 				}
 			}
 			else if (hint == tree_value.head->left) {
-				if (tree_value.comp(key, Traits::getKeyFromValue(tree_value.head->left->value))) {
+				if (comp(key, Traits::getKeyFromValue(tree_value.head->left->value))) {
 					return { {tree_value.head->left, NodeChild::left}, false };
 				}
 			}
-			else if (tree_value.comp(key, Traits::getKeyFromValue(hint->value))) {
+			else if (comp(key, Traits::getKeyFromValue(hint->value))) {
 				NodePtr prev = (--(uncheked_iterator(&tree_value, hint))).ptr;
-				if (tree_value.comp(Traits::getKeyFromValue(prev->value), key)) {
+				if (comp(Traits::getKeyFromValue(prev->value), key)) {
 					if (prev->right->is_nil) return { {prev, NodeChild::right}, false };
 					else return { {hint, NodeChild::left}, false };
 				}
 			}
-			else if (tree_value.comp(Traits::getKeyFromValue(hint->value), key)) {
+			else if (comp(Traits::getKeyFromValue(hint->value), key)) {
 				NodePtr next = (++(uncheked_iterator(&tree_value, hint))).ptr;
-				if (tree_value.comp(key, Traits::getKeyFromValue(next->value))) {
+				if (comp(key, Traits::getKeyFromValue(next->value))) {
 					if (hint->right->is_nil) return { {hint, NodeChild::right}, false };
 					else return { {next, NodeChild::left}, false };
 				}
@@ -883,6 +2388,19 @@ namespace mylib {
 		}
 
 		size_type erase(const key_type& key) {
+			if constexpr (multi_keys) {
+				std::pair<NodePtr, NodePtr> range = equalRangeNodes(key);
+				size_type erased = 0;
+				while (range.first != range.second) {
+					const NodePtr node = std::exchange(range.first, tree_value.nextNode(range.first));
+					tree_value.orphanPtr(node);
+					tree_value.extractNode(node);
+					Node::freeNode(tree_value.alloc, node);
+					++erased;
+				}
+				return erased;
+			}
+
 			TreeFindResult<NodePtr> result = findPlaceForNode(key);
 			if (result.duplicate) {
 				tree_value.orphanPtr(result.location.parent);
@@ -913,18 +2431,81 @@ namespace mylib {
 			return last.ptr;
 		}
 
+		template<class Predicate>
+		size_type eraseIf_(Predicate&& pred) {
+			NodePtr erased{};
+			size_type count = 0;
+
+			uncheked_iterator it(nullptr, tree_value.head->left);
+			while (!it.ptr->is_nil) {
+				const NodePtr node = (it++).ptr;
+				if (pred(node->value)) {
+					tree_value.extractNode(node);
+					node->parent	= NodePtr{};
+					node->left		= erased;
+					erased			= node;
+					++count;
+				}
+			}
+
+			if (count) {
+				tree_value.orphanUnlinked();
+				while (erased) {
+					Node::freeNode(tree_value.alloc, std::exchange(erased, erased->left));
+				}
+			}
+			return count;
+		}
+
+		template<class Predicate>
+		size_type eraseIf(Predicate pred) {
+			return eraseIf_(pred);
+		}
+
+		// The predicate is evaluated on thread_count threads at once, so it must be safe to call concurrently.
+		template<class Predicate>
+		size_type eraseIf(Predicate pred, unsigned thread_count) {
+			std::vector<NodePtr> nodes;
+			nodes.reserve(tree_value.size);
+			for (uncheked_iterator it(nullptr, tree_value.head->left); !it.ptr->is_nil; ++it) {
+				nodes.push_back(it.ptr);
+			}
+
+			std::vector<unsigned char> erase_flags(nodes.size());
+			parallelFor(nodes.size(), thread_count, [&](std::size_t first, std::size_t last) {
+				for (; first != last; ++first) erase_flags[first] = pred(nodes[first]->value) ? 1 : 0;
+			});
+
+			std::size_t index = 0;
+			return eraseIf_([&](const value_type&) { return erase_flags[index++] != 0; });
+		}
+
+		template<class Predicate>
+		size_type retain(Predicate pred) {
+			return eraseIf_([&pred](value_type& value) { return !pred(value); });
+		}
+
+		template<class Predicate>
+		size_type retain(Predicate pred, unsigned thread_count) {
+			return eraseIf([&pred](value_type& value) { return !pred(value); }, thread_count);
+		}
+
 		void checkGrow() const noexcept {
 			assert(maxSize() != tree_value.size && "The lack of memory error");
 		}
 
-		[[nodiscard]] size_type size() {
+		[[nodiscard]] size_type size() const noexcept {
 			return tree_value.size;
 		}
 
-		[[nodiscard]] bool empty() {
+		[[nodiscard]] bool empty() const noexcept {
 			return tree_value.size == size_type{ 0 };
 		}
 
+		[[nodiscard]] key_compare keyComp() const {
+			return tree_value.comp;
+		}
+
 		[[nodiscard]] size_type maxSize() const noexcept {
 			return std::min(static_cast<size_type>(std::numeric_limits<difference_type>::max()), AllocTraits::max_size(tree_value.alloc));
 		}
@@ -980,15 +2561,7 @@ namespace mylib {
 		}
 
 		TreeUncheckedIterator& operator++() noexcept {
-			if (ptr->is_nil) ptr = ptr->left;
-			else if (ptr->right->is_nil) {
-				while (!ptr->parent->is_nil && ptr->parent->right == ptr) {
-					ptr = ptr->parent;
-				}
-				ptr = ptr->parent;
-			}
-			else ptr = TreeValue::minInSubTree(ptr->right);
-
+			ptr = TreeValue::nextNode(ptr);
 			return *this;
 		}
 
@@ -999,15 +2572,7 @@ namespace mylib {
 		}
 
 		TreeUncheckedIterator& operator--() noexcept {
-			if (ptr->is_nil) ptr = ptr->right;
-			else if (ptr->left->is_nil) {
-				while (!ptr->parent->is_nil && ptr->parent->left == ptr) { 
-					ptr = ptr->parent;
-				}
-				ptr = ptr->parent;
-			}
-			else ptr = TreeValue::maxInSubTree(ptr->left);
-
+			ptr = TreeValue::prevNode(ptr);
 			return *this;
 		}
 
@@ -1064,20 +2629,20 @@ namespace mylib {
 		}
 
 		TreeConstIterator operator++(int) noexcept {
-			TreeIterator tmp = *this;
+			TreeConstIterator tmp = *this;
 			++*this;
 			return tmp;
 		}
 
 		TreeConstIterator& operator--() noexcept {
 			assert(this->getContainer() && "Invalid iterator error");
-			assert(this->ptr != static_cast<TreeValue*>(this->getContainer())->head->left && "Decrementing the begin error");
+			assert(this->ptr != static_cast<const TreeValue*>(this->getContainer())->head->left && "Decrementing the begin error");
 			Base::operator--();
 			return *this;
 		}
 
 		TreeConstIterator operator--(int) noexcept {
-			TreeIterator tmp = *this;
+			TreeConstIterator tmp = *this;
 			--*this;
 			return tmp;
 		}
@@ -0,0 +1,618 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <stdexcept>
+#include "ContainerUtilities.h"
+
+namespace mylib {
+	// A node is shared by every map and parent node that points to it and counts them in refs. A shared node is never
+	// changed: a map copies it first and points to the copy instead, which is how a change copies only its path.
+	template<class ValueType, class VoidPtr>
+	struct PersistentMapNode {
+		using value_type	= ValueType;
+		using NodePtr		= typename std::pointer_traits<VoidPtr>::template rebind<PersistentMapNode>;
+
+		NodePtr left;
+		NodePtr right;
+		std::atomic<std::size_t> refs;
+		unsigned char height;
+		ValueType value;
+	};
+
+	template<class MapValue>
+	class PersistentMapConstIterator;
+
+	template<class Key, class T, class Compare, class Allocator>
+	class PersistentMapValue : public ContainerBase {
+	public:
+		using allocator_type	= Allocator;
+		using key_type			= Key;
+		using mapped_type		= T;
+		using value_type		= std::pair<const Key, T>;
+		using key_compare		= Compare;
+
+		using Node				= PersistentMapNode<value_type, typename std::allocator_traits<allocator_type>::void_pointer>;
+		using Alloc				= typename std::allocator_traits<allocator_type>::template rebind_alloc<Node>;
+		using AllocTraits		= std::allocator_traits<Alloc>;
+		using NodePtr			= typename AllocTraits::pointer;
+
+		using size_type			= typename AllocTraits::size_type;
+		using difference_type	= typename AllocTraits::difference_type;
+
+		static constexpr std::size_t max_height = 92; // an AVL tree of 2^64 nodes is below 93 levels
+
+		template<class AnyKeyCompare, class AnyAlloc>
+		PersistentMapValue(AnyKeyCompare&& comp, AnyAlloc&& alloc) : comp{ std::forward<AnyKeyCompare>(comp) }, alloc{ std::forward<AnyAlloc>(alloc) },
+			root{}, size{} {}
+
+		[[nodiscard]] static unsigned char heightOf(NodePtr node) noexcept {
+			return node ? node->height : 0;
+		}
+
+		static void updateHeight(NodePtr node) noexcept {
+			node->height = std::max(heightOf(node->left), heightOf(node->right)) + 1;
+		}
+
+		template<class... Args>
+		[[nodiscard]] NodePtr createNode(NodePtr left, NodePtr right, Args&&... args) {
+			const NodePtr node = alloc.allocate(1);
+			try {
+				construct(alloc, std::addressof(node->value), std::forward<Args>(args)...);
+			}
+			catch (...) {
+				alloc.deallocate(node, 1);
+				throw;
+			}
+			construct(alloc, std::addressof(node->left), left);
+			construct(alloc, std::addressof(node->right), right);
+			construct(alloc, std::addressof(node->refs), std::size_t{ 1 });
+			updateHeight(node);
+			return node;
+		}
+
+		static void acquire(NodePtr node) noexcept {
+			if (node) node->refs.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		void release(NodePtr node) noexcept {
+			while (node && node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				release(node->left);
+				const NodePtr right = node->right;
+				destroy(alloc, std::addressof(node->value));
+				destroy(alloc, std::addressof(node->refs));
+				destroy(alloc, std::addressof(node->right));
+				destroy(alloc, std::addressof(node->left));
+				alloc.deallocate(node, 1);
+				node = right;
+			}
+		}
+
+		// A node is only reached through its parent, so if the parent is not shared and refs is one, no other map can
+		// reach the node either and it may be changed in place.
+		void makeUnique(NodePtr& node) {
+			if (node->refs.load(std::memory_order_acquire) == 1) return;
+
+			const NodePtr copy = createNode(node->left, node->right, node->value); // throws
+			acquire(copy->left);
+			acquire(copy->right);
+			release(node);
+			node = copy;
+		}
+
+		static void rotateLeft(NodePtr& node) noexcept { // node and its right child have to be unshared
+			const NodePtr right_child = node->right;
+			node->right = right_child->left;
+			updateHeight(node);
+			right_child->left = node;
+			updateHeight(right_child);
+			node = right_child;
+		}
+
+		static void rotateRight(NodePtr& node) noexcept { // node and its left child have to be unshared
+			const NodePtr left_child = node->left;
+			node->left = left_child->right;
+			updateHeight(node);
+			left_child->right = node;
+			updateHeight(left_child);
+			node = left_child;
+		}
+
+		// Restores the balance of an unshared node whose subtrees changed in height by at most one. The nodes a rotation
+		// moves are unshared by then: an insertion has copied them on its way down, as they lie on its path, and an
+		// erasure copies them with unshareRotated before it unlinks anything. So the calls to makeUnique never copy here.
+		void balance(NodePtr& node) {
+			const int difference = heightOf(node->right) - heightOf(node->left);
+			if (difference > 1) {
+				makeUnique(node->right);
+				if (heightOf(node->right->right) < heightOf(node->right->left)) {
+					makeUnique(node->right->left);
+					rotateRight(node->right);
+				}
+				rotateLeft(node);
+				return;
+			}
+			if (difference < -1) {
+				makeUnique(node->left);
+				if (heightOf(node->left->left) < heightOf(node->left->right)) {
+					makeUnique(node->left->right);
+					rotateLeft(node->left);
+				}
+				rotateRight(node);
+				return;
+			}
+			updateHeight(node);
+		}
+
+		template<class K>
+		[[nodiscard]] NodePtr findNode(const K& key) const noexcept {
+			NodePtr node = root;
+			while (node) {
+				if (comp(key, node->value.first)) node = node->left;
+				else if (comp(node->value.first, key)) node = node->right;
+				else break;
+			}
+			return node;
+		}
+
+		// The iterator path to the node insertPath or uniquePathTo reached, gathered bottom-up while they unwind: the
+		// node itself first, then the nodes above it at which the way down goes left.
+		struct PathToNode {
+			std::array<NodePtr, max_height> nodes;
+			unsigned char depth;
+		};
+
+		// Inserts a key that is not in the tree. Only the creation of the new node may throw, before any change.
+		template<class K, class... Args>
+		void insertPath(NodePtr& node, const K& key, PathToNode& path, Args&&... args) {
+			if (!node) {
+				node = createNode(nullptr, nullptr, std::forward<Args>(args)...); // throws
+				++size;
+				path.nodes[0] = node;
+				path.depth = 1;
+				return;
+			}
+
+			makeUnique(node); // throws
+			const NodePtr unbalanced = node;
+			const bool goes_left = comp(key, node->value.first);
+			if (goes_left) insertPath(node->left, key, path, std::forward<Args>(args)...);
+			else insertPath(node->right, key, path, std::forward<Args>(args)...);
+			balance(node);
+
+			if (node != unbalanced) pathBelow(node, key, path); // a rotation moved the nodes above the new one
+			else if (goes_left) path.nodes[path.depth++] = node;
+		}
+
+		// Gathers the path anew from the top of a subtree that a rotation rebuilt down to the node in path
+		template<class K>
+		void pathBelow(NodePtr node, const K& key, PathToNode& path) const noexcept {
+			std::array<NodePtr, max_height> left_turns;
+			std::size_t count = 0;
+			for (const NodePtr target = path.nodes[0]; node != target;) {
+				if (comp(key, node->value.first)) {
+					left_turns[count++] = node;
+					node = node->left;
+				}
+				else node = node->right;
+			}
+
+			path.depth = 1;
+			while (count) path.nodes[path.depth++] = left_turns[--count];
+		}
+
+		template<class K>
+		[[nodiscard]] NodePtr& uniquePathTo(NodePtr& node, const K& key, PathToNode& path) { // the key has to be in the tree
+			makeUnique(node); // throws
+			if (comp(key, node->value.first)) {
+				NodePtr& found = uniquePathTo(node->left, key, path);
+				path.nodes[path.depth++] = node;
+				return found;
+			}
+			if (comp(node->value.first, key)) return uniquePathTo(node->right, key, path);
+
+			path.nodes[0] = node;
+			path.depth = 1;
+			return node;
+		}
+
+		// Copies the shared nodes balance would rotate should the subtree on one side of an unshared node lose a level:
+		// the taller subtree on the other side and, when the rotation is a double one, its inner child. Only the side
+		// an erasure goes down can lose a level, so the copies it needs are known before anything is unlinked.
+		void unshareRotated(NodePtr node, bool left_shrinks) {
+			if (left_shrinks) {
+				if (heightOf(node->right) <= heightOf(node->left)) return;
+				makeUnique(node->right); // throws
+				if (heightOf(node->right->right) < heightOf(node->right->left)) makeUnique(node->right->left); // throws
+			}
+			else {
+				if (heightOf(node->left) <= heightOf(node->right)) return;
+				makeUnique(node->left); // throws
+				if (heightOf(node->left->left) < heightOf(node->left->right)) makeUnique(node->left->right); // throws
+			}
+		}
+
+		[[nodiscard]] NodePtr extractMin(NodePtr& node) {
+			makeUnique(node); // throws
+			if (!node->left) {
+				const NodePtr min = node;
+				node = min->right;
+				min->right = nullptr;
+				return min;
+			}
+
+			unshareRotated(node, true); // throws
+			const NodePtr min = extractMin(node->left);
+			balance(node);
+			return min;
+		}
+
+		// Erases a key that is in the tree. Copies on the way down may throw, but nothing changes after the node is unlinked.
+		template<class K>
+		void erasePath(NodePtr& node, const K& key) {
+			if (comp(key, node->value.first)) {
+				makeUnique(node); // throws
+				unshareRotated(node, true); // throws
+				erasePath(node->left, key);
+			}
+			else if (comp(node->value.first, key)) {
+				makeUnique(node); // throws
+				unshareRotated(node, false); // throws
+				erasePath(node->right, key);
+			}
+			else if (!node->left || !node->right) { // the erased node itself is left as it is, only its parent changes
+				const NodePtr erased = node;
+				node = erased->left ? erased->left : erased->right;
+				acquire(node);
+				release(erased);
+				--size;
+				return;
+			}
+			else {
+				makeUnique(node); // throws
+				unshareRotated(node, false); // throws
+				const NodePtr successor = extractMin(node->right); // throws
+				successor->left		= node->left;
+				successor->right	= node->right;
+				node->left			= nullptr;
+				node->right			= nullptr;
+				release(std::exchange(node, successor));
+				--size;
+			}
+			balance(node);
+		}
+
+		key_compare comp;
+		Alloc alloc;
+		NodePtr root;
+		size_type size;
+	};
+
+	// Holds the path from the root to the current node, keeping only the nodes at which it goes left, so a step
+	// takes no parent links. Iterators stay valid until the map they came from changes, as snapshots do not change.
+	template<class MapValue>
+	class PersistentMapConstIterator : public IteratorBase {
+	public:
+		using NodePtr			= typename MapValue::NodePtr;
+		using value_type		= typename MapValue::value_type;
+		using difference_type	= typename MapValue::difference_type;
+		using reference			= const value_type&;
+		using pointer			= const value_type*;
+
+		PersistentMapConstIterator() : depth{} {}
+
+		explicit PersistentMapConstIterator(const MapValue* container) : depth{} {
+			this->adopt(container);
+		}
+
+		void push(NodePtr node) noexcept {
+			path[depth++] = node;
+		}
+
+		[[nodiscard]] reference operator*() const noexcept {
+			assert(this->getContainer() && "Invalid iterator error");
+			assert(depth && "The try of dereferencing end");
+			return path[depth - 1]->value;
+		}
+
+		[[nodiscard]] pointer operator->() const noexcept {
+			return std::addressof(**this);
+		}
+
+		PersistentMapConstIterator& operator++() noexcept {
+			assert(this->getContainer() && "Invalid iterator error");
+			assert(depth && "Incrementing the end error");
+			for (NodePtr node = path[--depth]->right; node; node = node->left) push(node);
+			return *this;
+		}
+
+		PersistentMapConstIterator operator++(int) noexcept {
+			PersistentMapConstIterator tmp = *this;
+			++*this;
+			return tmp;
+		}
+
+		[[nodiscard]] bool operator==(const PersistentMapConstIterator& rhs) const noexcept {
+			if (!this->getContainer() || !rhs.getContainer()) return false;
+			return depth == rhs.depth && (!depth || path[depth - 1] == rhs.path[depth - 1]);
+		}
+
+		[[nodiscard]] bool operator!=(const PersistentMapConstIterator& rhs) const noexcept {
+			return !(*this == rhs);
+		}
+
+		std::array<NodePtr, MapValue::max_height> path;
+		unsigned char depth;
+	};
+
+	// An ordered map whose copies share all nodes, so a snapshot takes O(1) and an insertion or erasure copies only
+	// the O(log n) nodes on its path that are shared. Reference counts are atomic: a snapshot may be read and destroyed
+	// on another thread while the map it came from keeps changing, with no locks on either side. All copies of the
+	// allocator have to be able to free each other's nodes, as the last map to drop a node frees it.
+	template<class Key, class T, class Compare = std::less<Key>, class Allocator = std::allocator<std::pair<const Key, T>>>
+	class PersistentMap {
+	public:
+		using allocator_type	= Allocator;
+		using key_type			= Key;
+		using mapped_type		= T;
+		using value_type		= std::pair<const Key, T>;
+		using key_compare		= Compare;
+
+	protected:
+		using MapValue			= PersistentMapValue<Key, T, Compare, Allocator>;
+		using Node				= typename MapValue::Node;
+		using Alloc				= typename MapValue::Alloc;
+		using AllocTraits		= typename MapValue::AllocTraits;
+		using NodePtr			= typename MapValue::NodePtr;
+
+	public:
+		using size_type			= typename MapValue::size_type;
+		using difference_type	= typename MapValue::difference_type;
+		using reference			= const value_type&;
+		using const_reference	= const value_type&;
+
+		using iterator			= PersistentMapConstIterator<MapValue>; // values are shared, so they are never changed in place
+		using const_iterator	= PersistentMapConstIterator<MapValue>;
+
+		PersistentMap() : PersistentMap(Compare{}, Allocator{}) {}
+
+		explicit PersistentMap(const Compare& comp, const Allocator& alloc = Allocator()) : map_value(comp, alloc) {
+			createProxy();
+		}
+
+		explicit PersistentMap(const Allocator& alloc) : PersistentMap(Compare{}, alloc) {}
+
+		template<class InputIt>
+		PersistentMap(InputIt first, InputIt last, const Compare& comp = Compare(), const Allocator& alloc = Allocator()) : PersistentMap(comp, alloc) {
+			insert(first, last);
+		}
+
+		PersistentMap(std::initializer_list<value_type> init, const Compare& comp = Compare(), const Allocator& alloc = Allocator()) : PersistentMap(comp, alloc) {
+			insert(init.begin(), init.end());
+		}
+
+		PersistentMap(const PersistentMap& other) : map_value(other.map_value.comp, other.map_value.alloc) {
+			createProxy();
+			share(other);
+		}
+
+		PersistentMap(PersistentMap&& other) : map_value(other.map_value.comp, other.map_value.alloc) {
+			createProxy();
+			swapMapValue(other);
+		}
+
+		PersistentMap& operator=(const PersistentMap& other) {
+			if (this == &other) return *this;
+
+			clear();
+			map_value.comp = other.map_value.comp;
+			if constexpr (!AllocTraits::is_always_equal::value) { // nodes are shared, so the allocator goes along regardless of propagation
+				if (map_value.alloc != other.map_value.alloc) {
+					deleteProxy();
+					map_value.alloc = other.map_value.alloc;
+					createProxy();
+				}
+			}
+			share(other);
+			return *this;
+		}
+
+		PersistentMap& operator=(PersistentMap&& other) {
+			if (this == &other) return *this;
+
+			clear();
+			if constexpr (!AllocTraits::is_always_equal::value) {
+				if (map_value.alloc != other.map_value.alloc) {
+					deleteProxy();
+					map_value.alloc = other.map_value.alloc;
+					createProxy();
+				}
+			}
+			swapMapValue(other);
+			return *this;
+		}
+
+		~PersistentMap() {
+			clear();
+			deleteProxy();
+		}
+
+		// The snapshot keeps the current contents, whatever happens to this map later, and may be handed to another thread.
+		[[nodiscard]] PersistentMap snapshot() const {
+			return *this;
+		}
+
+		void swap(PersistentMap& other) {
+			if (this == &other) return;
+			std::swap(map_value.alloc, other.map_value.alloc);
+			swapMapValue(other);
+		}
+
+		template<class InputIt>
+		void insert(InputIt first, InputIt last) {
+			for (; first != last; ++first) insert(*first);
+		}
+
+		void insert(std::initializer_list<value_type> init) {
+			insert(init.begin(), init.end());
+		}
+
+		std::pair<iterator, bool> insert(const value_type& value) {
+			return tryEmplace(value.first, value.second);
+		}
+
+		std::pair<iterator, bool> insert(value_type&& value) {
+			return tryEmplace(value.first, std::move(value.second));
+		}
+
+		template<class... Args>
+		std::pair<iterator, bool> tryEmplace(const key_type& key, Args&&... args) {
+			const_iterator it = lowerBound(key);
+			if (it.depth && !map_value.comp(key, it->first)) return { it, false };
+			return { insertNew(key, std::forward<Args>(args)...), true };
+		}
+
+		template<class M>
+		std::pair<iterator, bool> insertOrAssign(const key_type& key, M&& obj) {
+			if (!map_value.findNode(key)) return { insertNew(key, std::forward<M>(obj)), true };
+
+			map_value.orphanAll();
+			typename MapValue::PathToNode path;
+			map_value.uniquePathTo(map_value.root, key, path)->value.second = std::forward<M>(obj);
+			return { makeIterator(path), false };
+		}
+
+		size_type erase(const key_type& key) {
+			if (!map_value.findNode(key)) return 0;
+
+			map_value.orphanAll();
+			map_value.erasePath(map_value.root, key);
+			return 1;
+		}
+
+		void clear() noexcept {
+			map_value.orphanAll();
+			map_value.release(std::exchange(map_value.root, nullptr));
+			map_value.size = 0;
+		}
+
+		[[nodiscard]] const_iterator find(const key_type& key) const noexcept {
+			const_iterator it = lowerBound(key);
+			if (it.depth && !map_value.comp(key, it->first)) return it;
+			return end();
+		}
+
+		[[nodiscard]] bool contains(const key_type& key) const noexcept {
+			return map_value.findNode(key) != nullptr;
+		}
+
+		[[nodiscard]] size_type count(const key_type& key) const noexcept {
+			return contains(key);
+		}
+
+		[[nodiscard]] const T& at(const key_type& key) const {
+			const NodePtr node = map_value.findNode(key);
+			if (!node) throw std::out_of_range("Invalid key");
+			return node->value.second;
+		}
+
+		[[nodiscard]] const_iterator lowerBound(const key_type& key) const noexcept {
+			const_iterator it(&map_value);
+			for (NodePtr node = map_value.root; node;) {
+				if (map_value.comp(node->value.first, key)) node = node->right;
+				else {
+					it.push(node);
+					node = node->left;
+				}
+			}
+			return it;
+		}
+
+		[[nodiscard]] const_iterator upperBound(const key_type& key) const noexcept {
+			const_iterator it(&map_value);
+			for (NodePtr node = map_value.root; node;) {
+				if (!map_value.comp(key, node->value.first)) node = node->right;
+				else {
+					it.push(node);
+					node = node->left;
+				}
+			}
+			return it;
+		}
+
+		[[nodiscard]] const_iterator begin() const noexcept {
+			const_iterator it(&map_value);
+			for (NodePtr node = map_value.root; node; node = node->left) it.push(node);
+			return it;
+		}
+
+		[[nodiscard]] const_iterator end() const noexcept {
+			return const_iterator(&map_value);
+		}
+
+		[[nodiscard]] const_iterator cbegin() const noexcept {
+			return begin();
+		}
+
+		[[nodiscard]] const_iterator cend() const noexcept {
+			return end();
+		}
+
+		[[nodiscard]] size_type size() const noexcept {
+			return map_value.size;
+		}
+
+		[[nodiscard]] bool empty() const noexcept {
+			return !map_value.size;
+		}
+
+		[[nodiscard]] allocator_type getAllocator() const noexcept {
+			return static_cast<allocator_type>(map_value.alloc);
+		}
+
+		[[nodiscard]] key_compare keyComp() const {
+			return map_value.comp;
+		}
+
+	protected:
+		template<class... Args>
+		[[nodiscard]] iterator insertNew(const key_type& key, Args&&... args) { // the key may not be in the map
+			map_value.orphanAll();
+			typename MapValue::PathToNode path;
+			map_value.insertPath(map_value.root, key, path, std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+			return makeIterator(path);
+		}
+
+		[[nodiscard]] iterator makeIterator(const typename MapValue::PathToNode& path) const noexcept {
+			iterator it(&map_value);
+			for (std::size_t i = path.depth; i;) it.push(path.nodes[--i]);
+			return it;
+		}
+
+		void share(const PersistentMap& other) noexcept {
+			MapValue::acquire(other.map_value.root);
+			map_value.root = other.map_value.root;
+			map_value.size = other.map_value.size;
+		}
+
+		void swapMapValue(PersistentMap& other) noexcept {
+			std::swap(map_value.root, other.map_value.root);
+			std::swap(map_value.comp, other.map_value.comp);
+			std::swap(map_value.size, other.map_value.size);
+			std::swap(map_value.proxy, other.map_value.proxy);
+
+			other.map_value.proxy->parent = &other.map_value;
+			map_value.proxy->parent = &map_value;
+		}
+
+		void createProxy() {
+			map_value.createProxy(static_cast<typename AllocTraits::template rebind_alloc<IteratorProxy>>(map_value.alloc));
+		}
+
+		void deleteProxy() {
+			map_value.orphanAll();
+			map_value.deleteProxy(static_cast<typename AllocTraits::template rebind_alloc<IteratorProxy>>(map_value.alloc));
+		}
+
+		MapValue map_value;
+	};
+}
\ No newline at end of file
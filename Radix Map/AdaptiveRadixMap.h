@@ -0,0 +1,1288 @@
+#pragma once
+#include <array>
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include "ContainerUtilities.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
+
+namespace mylib {
+	// Turns a key into the bytes a radix map orders it by. The bytes are compared as unsigned chars, and of two keys
+	// where one is a prefix of the other the shorter goes first. encode returns an object with data() and size().
+	template<class Key, class = void>
+	struct RadixKeyTraits;
+
+	template<class Key>
+	struct RadixKeyTraits<Key, std::enable_if_t<std::is_integral_v<Key> && !std::is_same_v<Key, bool>>> { // big-endian, sign bit flipped
+		using encoded_type = std::array<unsigned char, sizeof(Key)>;
+
+		[[nodiscard]] static encoded_type encode(Key key) noexcept {
+			using Unsigned = std::make_unsigned_t<Key>;
+			Unsigned bits = static_cast<Unsigned>(key);
+			if constexpr (std::is_signed_v<Key>) bits ^= static_cast<Unsigned>(Unsigned{ 1 } << (sizeof(Key) * 8 - 1));
+
+			encoded_type encoded;
+			for (std::size_t i = sizeof(Key); i-- > 0;) {
+				encoded[i] = static_cast<unsigned char>(bits & 0xFF);
+				bits = static_cast<Unsigned>(bits >> 8);
+			}
+			return encoded;
+		}
+	};
+
+	template<class CharT, class Traits, class Alloc>
+	struct RadixKeyTraits<std::basic_string<CharT, Traits, Alloc>> {
+		static_assert(sizeof(CharT) == 1, "Only strings of single-byte characters can be radix keys");
+
+		using encoded_type = std::basic_string_view<CharT, Traits>;
+
+		[[nodiscard]] static encoded_type encode(const std::basic_string<CharT, Traits, Alloc>& key) noexcept {
+			return key;
+		}
+	};
+
+	struct RadixKeyBytes {
+		template<class Encoded>
+		explicit RadixKeyBytes(const Encoded& encoded) noexcept : data{ reinterpret_cast<const unsigned char*>(encoded.data()) }, size{ encoded.size() } {}
+
+		[[nodiscard]] bool operator==(const RadixKeyBytes& rhs) const noexcept {
+			return size == rhs.size && !std::memcmp(data, rhs.data, size);
+		}
+
+		const unsigned char* data;
+		std::size_t size;
+	};
+
+	enum class RadixNodeType : unsigned char {
+		node4,
+		node16,
+		node48,
+		node256,
+	};
+
+	template<class ValueType>
+	struct RadixLeaf { // leaves are linked in key order, so iteration never goes through the inner nodes
+		RadixLeaf* next;
+		RadixLeaf* prev;
+		ValueType value;
+	};
+
+	template<class Leaf>
+	struct RadixNode;
+
+	template<class Leaf>
+	class RadixRef { // a leaf or an inner node, told apart by the lowest bit
+	public:
+		RadixRef() noexcept : bits{} {}
+		RadixRef(Leaf* leaf) noexcept : bits{ leaf ? reinterpret_cast<std::uintptr_t>(leaf) | 1 : 0 } {}
+		RadixRef(RadixNode<Leaf>* node) noexcept : bits{ reinterpret_cast<std::uintptr_t>(node) } {}
+
+		[[nodiscard]] explicit operator bool() const noexcept {
+			return bits != 0;
+		}
+
+		[[nodiscard]] bool isLeaf() const noexcept {
+			return bits & 1;
+		}
+
+		[[nodiscard]] Leaf* leaf() const noexcept {
+			return reinterpret_cast<Leaf*>(bits & ~std::uintptr_t{ 1 });
+		}
+
+		[[nodiscard]] RadixNode<Leaf>* node() const noexcept {
+			return reinterpret_cast<RadixNode<Leaf>*>(bits);
+		}
+
+		std::uintptr_t bits;
+	};
+
+	// All keys below a node share prefix_length bytes after the byte that led to it. Only the first max_prefix of them
+	// are kept, and a longer prefix is skipped by lookups and checked against the key of a leaf when it matters. The
+	// terminal leaf holds the key that ends at the node, which sorts before all its children.
+	template<class Leaf>
+	struct RadixNode {
+		static constexpr std::size_t max_prefix = 8;
+
+		RadixNodeType type;
+		unsigned short count;
+		unsigned int prefix_length;
+		unsigned char prefix[max_prefix];
+		Leaf* terminal;
+	};
+
+	template<class Leaf>
+	struct RadixNode4 : RadixNode<Leaf> { // keys are kept sorted
+		static constexpr RadixNodeType node_type	= RadixNodeType::node4;
+		static constexpr std::size_t capacity		= 4;
+
+		unsigned char keys[capacity];
+		RadixRef<Leaf> children[capacity];
+	};
+
+	template<class Leaf>
+	struct RadixNode16 : RadixNode<Leaf> { // keys are kept sorted
+		static constexpr RadixNodeType node_type	= RadixNodeType::node16;
+		static constexpr std::size_t capacity		= 16;
+
+		unsigned char keys[capacity];
+		RadixRef<Leaf> children[capacity];
+	};
+
+	template<class Leaf>
+	struct RadixNode48 : RadixNode<Leaf> { // child_index holds the position in children plus one, children are packed
+		static constexpr RadixNodeType node_type	= RadixNodeType::node48;
+		static constexpr std::size_t capacity		= 48;
+
+		unsigned char child_index[256];
+		RadixRef<Leaf> children[capacity];
+	};
+
+	template<class Leaf>
+	struct RadixNode256 : RadixNode<Leaf> {
+		static constexpr RadixNodeType node_type	= RadixNodeType::node256;
+		static constexpr std::size_t capacity		= 256;
+
+		RadixRef<Leaf> children[capacity];
+	};
+
+	// Compares the byte with all 16 keys at once where SSE2 is available
+	[[nodiscard]] inline int radixFindKey16(const unsigned char* keys, std::size_t count, unsigned char byte) noexcept {
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		const __m128i matches = _mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(byte)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys)));
+		const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(matches)) & ((1u << count) - 1);
+		return mask ? static_cast<int>(countTrailingZeros(mask)) : -1;
+#else
+		for (std::size_t i = 0; i < count; ++i) {
+			if (keys[i] == byte) return static_cast<int>(i);
+		}
+		return -1;
+#endif
+	}
+
+	template<class MapValue>
+	class RadixMapConstIterator;
+
+	template<class Key, class T, class KeyTraits, class Allocator>
+	class RadixMapValue : public ContainerBase {
+	public:
+		using allocator_type	= Allocator;
+		using key_type			= Key;
+		using mapped_type		= T;
+		using value_type		= std::pair<const Key, T>;
+
+		using Leaf				= RadixLeaf<value_type>;
+		using Ref				= RadixRef<Leaf>;
+		using Node				= RadixNode<Leaf>;
+		using Node4				= RadixNode4<Leaf>;
+		using Node16			= RadixNode16<Leaf>;
+		using Node48			= RadixNode48<Leaf>;
+		using Node256			= RadixNode256<Leaf>;
+		using Alloc				= typename std::allocator_traits<allocator_type>::template rebind_alloc<Leaf>;
+		using AllocTraits		= std::allocator_traits<Alloc>;
+		using Encoded			= typename KeyTraits::encoded_type;
+
+		using size_type			= typename AllocTraits::size_type;
+		using difference_type	= typename AllocTraits::difference_type;
+
+		using const_iterator	= RadixMapConstIterator<RadixMapValue>;
+
+		template<class AnyAlloc>
+		explicit RadixMapValue(AnyAlloc&& alloc) : alloc{ std::forward<AnyAlloc>(alloc) }, root{}, first_leaf{}, last_leaf{}, size{} {}
+
+		[[nodiscard]] static Encoded encode(const Leaf* leaf) noexcept {
+			return KeyTraits::encode(leaf->value.first);
+		}
+
+		template<class... Args>
+		[[nodiscard]] Leaf* createLeaf(Args&&... args) {
+			Leaf* leaf = unfancy(alloc.allocate(1)); // throws
+			try {
+				construct(alloc, std::addressof(leaf->value), std::forward<Args>(args)...);
+			}
+			catch (...) {
+				alloc.deallocate(std::pointer_traits<typename AllocTraits::pointer>::pointer_to(*leaf), 1);
+				throw;
+			}
+			leaf->next = nullptr;
+			leaf->prev = nullptr;
+			return leaf;
+		}
+
+		void freeLeaf(Leaf* leaf) noexcept {
+			destroy(alloc, std::addressof(leaf->value));
+			alloc.deallocate(std::pointer_traits<typename AllocTraits::pointer>::pointer_to(*leaf), 1);
+		}
+
+		template<class NodeType>
+		[[nodiscard]] NodeType* createNode() {
+			using NodeAlloc = typename AllocTraits::template rebind_alloc<NodeType>;
+			NodeAlloc node_alloc(alloc);
+			NodeType* node = ::new(static_cast<void*>(unfancy(node_alloc.allocate(1)))) NodeType{}; // throws
+			node->type = NodeType::node_type;
+			return node;
+		}
+
+		template<class NodeType>
+		void freeNodeAs(Node* node) noexcept {
+			using NodeAlloc = typename AllocTraits::template rebind_alloc<NodeType>;
+			NodeAlloc node_alloc(alloc);
+			node_alloc.deallocate(std::pointer_traits<typename std::allocator_traits<NodeAlloc>::pointer>::pointer_to(static_cast<NodeType&>(*node)), 1);
+		}
+
+		void freeNode(Node* node) noexcept {
+			switch (node->type) {
+			case RadixNodeType::node4: freeNodeAs<Node4>(node); break;
+			case RadixNodeType::node16: freeNodeAs<Node16>(node); break;
+			case RadixNodeType::node48: freeNodeAs<Node48>(node); break;
+			case RadixNodeType::node256: freeNodeAs<Node256>(node); break;
+			}
+		}
+
+		void freeSubtree(Ref ref) noexcept {
+			if (!ref) return;
+			if (ref.isLeaf()) {
+				freeLeaf(ref.leaf());
+				return;
+			}
+
+			Node* node = ref.node();
+			if (node->terminal) freeLeaf(node->terminal);
+			forEachChild(node, [this](unsigned char, Ref child) { freeSubtree(child); });
+			freeNode(node);
+		}
+
+		// Calls fn(byte, child) for every child in byte order
+		template<class Fn>
+		static void forEachChild(const Node* node, Fn fn) {
+			switch (node->type) {
+			case RadixNodeType::node4: {
+				const Node4* node4 = static_cast<const Node4*>(node);
+				for (std::size_t i = 0; i < node->count; ++i) fn(node4->keys[i], node4->children[i]);
+				break;
+			}
+			case RadixNodeType::node16: {
+				const Node16* node16 = static_cast<const Node16*>(node);
+				for (std::size_t i = 0; i < node->count; ++i) fn(node16->keys[i], node16->children[i]);
+				break;
+			}
+			case RadixNodeType::node48: {
+				const Node48* node48 = static_cast<const Node48*>(node);
+				for (std::size_t byte = 0; byte < 256; ++byte) {
+					if (node48->child_index[byte]) fn(static_cast<unsigned char>(byte), node48->children[node48->child_index[byte] - 1]);
+				}
+				break;
+			}
+			case RadixNodeType::node256: {
+				const Node256* node256 = static_cast<const Node256*>(node);
+				for (std::size_t byte = 0; byte < 256; ++byte) {
+					if (node256->children[byte]) fn(static_cast<unsigned char>(byte), node256->children[byte]);
+				}
+				break;
+			}
+			}
+		}
+
+		[[nodiscard]] static Ref* findChild(Node* node, unsigned char byte) noexcept {
+			switch (node->type) {
+			case RadixNodeType::node4: {
+				Node4* node4 = static_cast<Node4*>(node);
+				for (std::size_t i = 0; i < node->count; ++i) {
+					if (node4->keys[i] == byte) return &node4->children[i];
+				}
+				return nullptr;
+			}
+			case RadixNodeType::node16: {
+				Node16* node16 = static_cast<Node16*>(node);
+				const int position = radixFindKey16(node16->keys, node->count, byte);
+				return position < 0 ? nullptr : &node16->children[position];
+			}
+			case RadixNodeType::node48: {
+				Node48* node48 = static_cast<Node48*>(node);
+				return node48->child_index[byte] ? &node48->children[node48->child_index[byte] - 1] : nullptr;
+			}
+			default: {
+				Node256* node256 = static_cast<Node256*>(node);
+				return node256->children[byte] ? &node256->children[byte] : nullptr;
+			}
+			}
+		}
+
+		// The child with the smallest byte above the given one, or an empty Ref
+		[[nodiscard]] static Ref childAbove(const Node* node, unsigned char byte) noexcept {
+			switch (node->type) {
+			case RadixNodeType::node4: {
+				const Node4* node4 = static_cast<const Node4*>(node);
+				for (std::size_t i = 0; i < node->count; ++i) {
+					if (node4->keys[i] > byte) return node4->children[i];
+				}
+				return {};
+			}
+			case RadixNodeType::node16: {
+				const Node16* node16 = static_cast<const Node16*>(node);
+				for (std::size_t i = 0; i < node->count; ++i) {
+					if (node16->keys[i] > byte) return node16->children[i];
+				}
+				return {};
+			}
+			case RadixNodeType::node48: {
+				const Node48* node48 = static_cast<const Node48*>(node);
+				for (std::size_t next = byte + std::size_t{ 1 }; next < 256; ++next) {
+					if (node48->child_index[next]) return node48->children[node48->child_index[next] - 1];
+				}
+				return {};
+			}
+			default: {
+				const Node256* node256 = static_cast<const Node256*>(node);
+				for (std::size_t next = byte + std::size_t{ 1 }; next < 256; ++next) {
+					if (node256->children[next]) return node256->children[next];
+				}
+				return {};
+			}
+			}
+		}
+
+		[[nodiscard]] static Ref firstChild(const Node* node) noexcept {
+			switch (node->type) {
+			case RadixNodeType::node4: return static_cast<const Node4*>(node)->children[0];
+			case RadixNodeType::node16: return static_cast<const Node16*>(node)->children[0];
+			case RadixNodeType::node48: {
+				const Node48* node48 = static_cast<const Node48*>(node);
+				for (std::size_t byte = 0; byte < 256; ++byte) {
+					if (node48->child_index[byte]) return node48->children[node48->child_index[byte] - 1];
+				}
+				return {};
+			}
+			default: {
+				const Node256* node256 = static_cast<const Node256*>(node);
+				for (std::size_t byte = 0; byte < 256; ++byte) {
+					if (node256->children[byte]) return node256->children[byte];
+				}
+				return {};
+			}
+			}
+		}
+
+		[[nodiscard]] static Leaf* minLeaf(Ref ref) noexcept {
+			while (!ref.isLeaf()) {
+				const Node* node = ref.node();
+				if (node->terminal) return node->terminal;
+				ref = firstChild(node);
+			}
+			return ref.leaf();
+		}
+
+		[[nodiscard]] static bool isFull(const Node* node) noexcept {
+			switch (node->type) {
+			case RadixNodeType::node4: return node->count == Node4::capacity;
+			case RadixNodeType::node16: return node->count == Node16::capacity;
+			case RadixNodeType::node48: return node->count == Node48::capacity;
+			default: return false;
+			}
+		}
+
+		// Allocates the node a full node grows into; addChild moves everything over
+		[[nodiscard]] Node* createGrown(const Node* node) {
+			switch (node->type) {
+			case RadixNodeType::node4: return createNode<Node16>();
+			case RadixNodeType::node16: return createNode<Node48>();
+			default: return createNode<Node256>();
+			}
+		}
+
+		static void copyHeader(Node* target, const Node* source) noexcept {
+			target->prefix_length	= source->prefix_length;
+			target->terminal		= source->terminal;
+			std::memcpy(target->prefix, source->prefix, Node::max_prefix);
+		}
+
+		// Moves all children of the node in slot into target, which takes its place
+		void replaceNode(Ref* slot, Node* target) noexcept {
+			Node* node = slot->node();
+			copyHeader(target, node);
+			target->count = 0;
+			forEachChild(node, [target](unsigned char byte, Ref child) { insertChild(target, byte, child); });
+			freeNode(node);
+			*slot = target;
+		}
+
+		static void insertChild(Node* node, unsigned char byte, Ref child) noexcept {
+			switch (node->type) {
+			case RadixNodeType::node4: insertSorted(static_cast<Node4*>(node), byte, child); break;
+			case RadixNodeType::node16: insertSorted(static_cast<Node16*>(node), byte, child); break;
+			case RadixNodeType::node48: {
+				Node48* node48 = static_cast<Node48*>(node);
+				node48->children[node->count] = child;
+				node48->child_index[byte] = static_cast<unsigned char>(node->count + 1);
+				break;
+			}
+			case RadixNodeType::node256: static_cast<Node256*>(node)->children[byte] = child; break;
+			}
+			++node->count;
+		}
+
+		template<class NodeType>
+		static void insertSorted(NodeType* node, unsigned char byte, Ref child) noexcept {
+			std::size_t position = node->count;
+			for (; position > 0 && node->keys[position - 1] > byte; --position) {
+				node->keys[position]		= node->keys[position - 1];
+				node->children[position]	= node->children[position - 1];
+			}
+			node->keys[position]		= byte;
+			node->children[position]	= child;
+		}
+
+		// grown is the node from createGrown when the node in slot is full, and nullptr otherwise
+		void addChild(Ref* slot, Node* grown, unsigned char byte, Ref child) noexcept {
+			if (grown) replaceNode(slot, grown);
+			insertChild(slot->node(), byte, child);
+		}
+
+		static void removeChild(Node* node, unsigned char byte) noexcept {
+			switch (node->type) {
+			case RadixNodeType::node4: removeSorted(static_cast<Node4*>(node), byte); break;
+			case RadixNodeType::node16: removeSorted(static_cast<Node16*>(node), byte); break;
+			case RadixNodeType::node48: { // the last child fills the hole, so children stay packed
+				Node48* node48 = static_cast<Node48*>(node);
+				const std::size_t position	= node48->child_index[byte] - 1;
+				const std::size_t last		= node->count - 1;
+				node48->child_index[byte] = 0;
+				if (position != last) {
+					for (std::size_t other = 0; other < 256; ++other) {
+						if (node48->child_index[other] == last + 1) {
+							node48->child_index[other] = static_cast<unsigned char>(position + 1);
+							break;
+						}
+					}
+					node48->children[position] = node48->children[last];
+				}
+				node48->children[last] = {};
+				break;
+			}
+			case RadixNodeType::node256: static_cast<Node256*>(node)->children[byte] = {}; break;
+			}
+			--node->count;
+		}
+
+		template<class NodeType>
+		static void removeSorted(NodeType* node, unsigned char byte) noexcept {
+			std::size_t position = 0;
+			while (node->keys[position] != byte) ++position;
+			for (; position + 1 < node->count; ++position) {
+				node->keys[position]		= node->keys[position + 1];
+				node->children[position]	= node->children[position + 1];
+			}
+			node->children[position] = {};
+		}
+
+		// After a removal, a node left with a single entry is replaced by it, and a sparse node by a smaller one. A failed
+		// allocation of the smaller node leaves the bigger one in place.
+		void shrink(Ref* slot) noexcept {
+			Node* node = slot->node();
+			if (node->count + (node->terminal ? 1 : 0) == 1) {
+				if (node->terminal) *slot = node->terminal;
+				else {
+					unsigned char byte = 0;
+					Ref child;
+					forEachChild(node, [&byte, &child](unsigned char only_byte, Ref only) {
+						byte	= only_byte;
+						child	= only;
+					});
+					if (!child.isLeaf()) prependPrefix(child.node(), node, byte);
+					*slot = child;
+				}
+				freeNode(node);
+				return;
+			}
+
+			try {
+				if (node->type == RadixNodeType::node16 && node->count <= 3) replaceNode(slot, createNode<Node4>());
+				else if (node->type == RadixNodeType::node48 && node->count <= 12) replaceNode(slot, createNode<Node16>());
+				else if (node->type == RadixNodeType::node256 && node->count <= 40) replaceNode(slot, createNode<Node48>());
+			}
+			catch (...) {}
+		}
+
+		// Gives the child the prefix of its parent followed by the byte that led to it, ahead of its own
+		static void prependPrefix(Node* child, const Node* parent, unsigned char byte) noexcept {
+			unsigned char prefix[Node::max_prefix];
+			std::size_t length = std::min<std::size_t>(parent->prefix_length, Node::max_prefix);
+			std::memcpy(prefix, parent->prefix, length);
+			if (length < Node::max_prefix) prefix[length++] = byte;
+			const std::size_t own = std::min<std::size_t>(child->prefix_length, Node::max_prefix - length);
+			std::memcpy(prefix + length, child->prefix, own);
+
+			std::memcpy(child->prefix, prefix, length + own);
+			child->prefix_length += parent->prefix_length + 1;
+		}
+
+		// The prefix bytes of the node in ref, which come from a leaf below it when they are not all kept in the node
+		[[nodiscard]] static const unsigned char* prefixBytes(Ref ref, std::size_t depth, Encoded& leaf_key) noexcept {
+			const Node* node = ref.node();
+			if (node->prefix_length <= Node::max_prefix) return node->prefix;
+			leaf_key = encode(minLeaf(ref));
+			return RadixKeyBytes(leaf_key).data + depth;
+		}
+
+		// The number of leading prefix bytes of the node in ref that match the key from depth on
+		[[nodiscard]] static std::size_t matchPrefix(Ref ref, RadixKeyBytes key, std::size_t depth) noexcept {
+			Encoded leaf_key{};
+			const unsigned char* prefix = prefixBytes(ref, depth, leaf_key);
+			const std::size_t length = std::min<std::size_t>(ref.node()->prefix_length, key.size - depth);
+			std::size_t matched = 0;
+			while (matched < length && prefix[matched] == key.data[depth + matched]) ++matched;
+			return matched;
+		}
+
+		[[nodiscard]] Leaf* findLeaf(RadixKeyBytes key) const noexcept {
+			Ref ref = root;
+			std::size_t depth = 0;
+			while (ref && !ref.isLeaf()) {
+				Node* node = ref.node();
+				const std::size_t kept = std::min<std::size_t>(node->prefix_length, Node::max_prefix);
+				if (key.size - depth < node->prefix_length || std::memcmp(node->prefix, key.data + depth, kept)) return nullptr;
+
+				depth += node->prefix_length;
+				if (depth == key.size) {
+					ref = node->terminal;
+					break;
+				}
+				Ref* child = findChild(node, key.data[depth++]);
+				if (!child) return nullptr;
+				ref = *child;
+			}
+			if (!ref || !(RadixKeyBytes(encode(ref.leaf())) == key)) return nullptr;
+			return ref.leaf();
+		}
+
+		[[nodiscard]] Leaf* lowerBoundLeaf(RadixKeyBytes key) const noexcept {
+			Ref ref = root;
+			Ref greater; // the lowest subtree seen so far that lies entirely above the key
+			std::size_t depth = 0;
+			while (ref) {
+				if (ref.isLeaf()) {
+					const Encoded leaf_key = encode(ref.leaf());
+					if (!lessThan(RadixKeyBytes(leaf_key), key)) return ref.leaf();
+					break;
+				}
+
+				Node* node = ref.node();
+				Encoded leaf_key{};
+				const unsigned char* prefix = prefixBytes(ref, depth, leaf_key);
+				for (std::size_t i = 0; i < node->prefix_length; ++i) {
+					if (depth + i == key.size || prefix[i] > key.data[depth + i]) return minLeaf(ref);
+					if (prefix[i] < key.data[depth + i]) return greater ? minLeaf(greater) : nullptr;
+				}
+
+				depth += node->prefix_length;
+				if (depth == key.size) return minLeaf(ref);
+
+				const unsigned char byte = key.data[depth++];
+				if (const Ref above = childAbove(node, byte)) greater = above;
+				Ref* child = findChild(node, byte);
+				if (!child) break;
+				ref = *child;
+			}
+			return greater ? minLeaf(greater) : nullptr;
+		}
+
+		[[nodiscard]] static bool lessThan(RadixKeyBytes left, RadixKeyBytes right) noexcept {
+			const int order = std::memcmp(left.data, right.data, std::min(left.size, right.size));
+			return order < 0 || (order == 0 && left.size < right.size);
+		}
+
+		// Puts the leaf before successor in the leaf list, or at its end when there is no successor
+		void link(Leaf* leaf, Leaf* successor) noexcept {
+			Leaf* predecessor = successor ? successor->prev : last_leaf;
+			leaf->prev = predecessor;
+			leaf->next = successor;
+			if (predecessor) predecessor->next = leaf;
+			else first_leaf = leaf;
+			if (successor) successor->prev = leaf;
+			else last_leaf = leaf;
+			++size;
+		}
+
+		void unlink(Leaf* leaf) noexcept {
+			if (leaf->prev) leaf->prev->next = leaf->next;
+			else first_leaf = leaf->next;
+			if (leaf->next) leaf->next->prev = leaf->prev;
+			else last_leaf = leaf->prev;
+			--size;
+		}
+
+		// Returns the leaf holding the key and false, or the leaf made by create() and true. create is only called once
+		// the inner nodes the leaf needs are allocated, so a throwing value constructor leaves the map as it was.
+		template<class Create>
+		std::pair<Leaf*, bool> findOrInsert(const key_type& key_value, Create create) {
+			const Encoded encoded = KeyTraits::encode(key_value);
+			const RadixKeyBytes key(encoded);
+
+			Ref* slot = &root;
+			Ref greater;
+			std::size_t depth = 0;
+			while (true) {
+				if (!*slot) {
+					Leaf* leaf = create();
+					*slot = leaf;
+					link(leaf, nullptr);
+					return { leaf, true };
+				}
+
+				if (slot->isLeaf()) {
+					Leaf* existing = slot->leaf();
+					const Encoded existing_encoded = encode(existing);
+					const RadixKeyBytes other(existing_encoded);
+					std::size_t common = depth;
+					while (common < key.size && common < other.size && key.data[common] == other.data[common]) ++common;
+					if (common == key.size && common == other.size) return { existing, false };
+
+					Node* node = createNode<Node4>(); // throws
+					setPrefix(node, key.data + depth, common - depth);
+					const bool key_ends		= common == key.size;
+					const bool goes_first	= key_ends || (common < other.size && key.data[common] < other.data[common]);
+					const unsigned char key_byte = key_ends ? 0 : key.data[common];
+					if (common == other.size) node->terminal = existing;
+					else insertChild(node, other.data[common], existing);
+
+					Leaf* leaf = createOrFree(create, node);
+					if (key_ends) node->terminal = leaf;
+					else insertChild(node, key_byte, leaf);
+					*slot = node;
+					link(leaf, goes_first ? existing : (greater ? minLeaf(greater) : nullptr));
+					return { leaf, true };
+				}
+
+				Node* node = slot->node();
+				const std::size_t matched = matchPrefix(*slot, key, depth);
+				if (matched < node->prefix_length) {
+					Node* parent = createNode<Node4>(); // throws
+					Encoded leaf_key{};
+					const unsigned char* prefix = prefixBytes(*slot, depth, leaf_key);
+					const unsigned char node_byte	= prefix[matched];
+					const bool key_ends				= depth + matched == key.size;
+					const unsigned char key_byte	= key_ends ? 0 : key.data[depth + matched];
+					Leaf* successor = key_ends || key_byte < node_byte ? minLeaf(*slot) : (greater ? minLeaf(greater) : nullptr);
+
+					setPrefix(parent, prefix, matched);
+					unsigned char rest[Node::max_prefix];
+					const std::size_t rest_length = node->prefix_length - matched - 1;
+					std::memcpy(rest, prefix + matched + 1, std::min<std::size_t>(rest_length, Node::max_prefix));
+					Leaf* leaf = createOrFree(create, parent);
+
+					setPrefix(node, rest, rest_length);
+					insertChild(parent, node_byte, node);
+					if (key_ends) parent->terminal = leaf;
+					else insertChild(parent, key_byte, leaf);
+					*slot = parent;
+					link(leaf, successor);
+					return { leaf, true };
+				}
+
+				depth += node->prefix_length;
+				if (depth == key.size) {
+					if (node->terminal) return { node->terminal, false };
+					Leaf* leaf = create();
+					node->terminal = leaf;
+					link(leaf, minLeaf(firstChild(node)));
+					return { leaf, true };
+				}
+
+				const unsigned char byte = key.data[depth];
+				const Ref above = childAbove(node, byte);
+				if (Ref* child = findChild(node, byte)) {
+					if (above) greater = above;
+					slot = child;
+					++depth;
+					continue;
+				}
+
+				Node* grown = isFull(node) ? createGrown(node) : nullptr; // throws
+				Leaf* leaf = createOrFree(create, grown);
+				Leaf* successor = above ? minLeaf(above) : (greater ? minLeaf(greater) : nullptr);
+				addChild(slot, grown, byte, leaf);
+				link(leaf, successor);
+				return { leaf, true };
+			}
+		}
+
+		// length may exceed max_prefix, bytes has to hold the first max_prefix bytes then
+		static void setPrefix(Node* node, const unsigned char* bytes, std::size_t length) noexcept {
+			node->prefix_length = static_cast<unsigned int>(length);
+			std::memmove(node->prefix, bytes, std::min<std::size_t>(length, Node::max_prefix));
+		}
+
+		template<class Create>
+		[[nodiscard]] Leaf* createOrFree(Create& create, Node* spare) {
+			try {
+				return create();
+			}
+			catch (...) {
+				if (spare) freeNode(spare);
+				throw;
+			}
+		}
+
+		// Takes the leaf out of the tree and the leaf list without freeing it
+		void extractLeaf(Leaf* leaf) noexcept {
+			const Encoded encoded = encode(leaf);
+			const RadixKeyBytes key(encoded);
+
+			Ref* slot = &root;
+			Ref* parent_slot = nullptr;
+			unsigned char byte = 0;
+			std::size_t depth = 0;
+			while (!slot->isLeaf()) {
+				Node* node = slot->node();
+				depth += node->prefix_length;
+				if (depth == key.size) {
+					node->terminal = nullptr;
+					shrink(slot);
+					unlink(leaf);
+					return;
+				}
+				parent_slot = slot;
+				byte = key.data[depth++];
+				slot = findChild(node, byte);
+			}
+
+			if (!parent_slot) root = {};
+			else {
+				removeChild(parent_slot->node(), byte);
+				shrink(parent_slot);
+			}
+			unlink(leaf);
+		}
+
+		void orphanLeaf(const Leaf* leaf) noexcept;
+
+		// Copies the subtree in key order, so the new leaves are appended to the leaf list as they are made. On a
+		// throw the nodes made so far stay reachable from target, so that freeSubtree can free them.
+		void cloneSubtree(Ref& target, Ref source) {
+			if (source.isLeaf()) {
+				Leaf* leaf = createLeaf(source.leaf()->value); // throws
+				target = leaf;
+				link(leaf, nullptr);
+				return;
+			}
+
+			const Node* node = source.node();
+			Node* copy;
+			switch (node->type) {
+			case RadixNodeType::node4: copy = createNode<Node4>(); break; // throws
+			case RadixNodeType::node16: copy = createNode<Node16>(); break; // throws
+			case RadixNodeType::node48: copy = createNode<Node48>(); break; // throws
+			default: copy = createNode<Node256>(); break; // throws
+			}
+			copyHeader(copy, node);
+			copy->terminal = nullptr;
+			target = copy;
+
+			if (node->terminal) {
+				copy->terminal = createLeaf(node->terminal->value); // throws
+				link(copy->terminal, nullptr);
+			}
+			forEachChild(node, [this, copy](unsigned char byte, Ref child) {
+				Ref cloned;
+				try {
+					cloneSubtree(cloned, child); // throws
+				}
+				catch (...) {
+					if (cloned) insertChild(copy, byte, cloned);
+					throw;
+				}
+				insertChild(copy, byte, cloned);
+			});
+		}
+
+		Alloc alloc;
+		Ref root;
+		Leaf* first_leaf;
+		Leaf* last_leaf;
+		size_type size;
+	};
+
+	template<class Key, class T, class KeyTraits, class Allocator>
+	void RadixMapValue<Key, T, KeyTraits, Allocator>::orphanLeaf(const Leaf* leaf) noexcept {
+		IteratorBase** orphan_it = &proxy->first;
+		while (*orphan_it) {
+			if (static_cast<const_iterator*>(*orphan_it)->leaf == leaf) {
+				(*orphan_it)->proxy = nullptr;
+				*orphan_it = (*orphan_it)->next_iterator;
+			}
+			else orphan_it = &(*orphan_it)->next_iterator;
+		}
+	}
+
+	// Walks the leaf list, so a step takes O(1). Insertions keep all iterators valid, an erasure invalidates the
+	// iterators to the erased value.
+	template<class MapValue>
+	class RadixMapConstIterator : public IteratorBase {
+	public:
+		using Leaf				= typename MapValue::Leaf;
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type		= typename MapValue::value_type;
+		using difference_type	= typename MapValue::difference_type;
+		using reference			= const value_type&;
+		using pointer			= const value_type*;
+
+		RadixMapConstIterator() : leaf{} {}
+
+		RadixMapConstIterator(const MapValue* container, Leaf* leaf) : leaf{ leaf } {
+			this->adopt(container);
+		}
+
+		[[nodiscard]] reference operator*() const noexcept {
+			assert(this->getContainer() && "Invalid iterator error");
+			assert(leaf && "The try of dereferencing end");
+			return leaf->value;
+		}
+
+		[[nodiscard]] pointer operator->() const noexcept {
+			return std::addressof(**this);
+		}
+
+		RadixMapConstIterator& operator++() noexcept {
+			assert(this->getContainer() && "Invalid iterator error");
+			assert(leaf && "Incrementing the end error");
+			leaf = leaf->next;
+			return *this;
+		}
+
+		RadixMapConstIterator operator++(int) noexcept {
+			RadixMapConstIterator tmp = *this;
+			++*this;
+			return tmp;
+		}
+
+		RadixMapConstIterator& operator--() noexcept {
+			assert(this->getContainer() && "Invalid iterator error");
+			const MapValue* container = static_cast<const MapValue*>(this->getContainer());
+			assert(leaf != container->first_leaf && "Decrementing the begin error");
+			leaf = leaf ? leaf->prev : container->last_leaf;
+			return *this;
+		}
+
+		RadixMapConstIterator operator--(int) noexcept {
+			RadixMapConstIterator tmp = *this;
+			--*this;
+			return tmp;
+		}
+
+		[[nodiscard]] bool operator==(const RadixMapConstIterator& rhs) const noexcept {
+			return (this->getContainer() && rhs.getContainer()) ? leaf == rhs.leaf : false;
+		}
+
+		[[nodiscard]] bool operator!=(const RadixMapConstIterator& rhs) const noexcept {
+			return !(*this == rhs);
+		}
+
+		Leaf* leaf;
+	};
+
+	template<class MapValue>
+	class RadixMapIterator : public RadixMapConstIterator<MapValue> {
+	public:
+		using Base				= RadixMapConstIterator<MapValue>;
+		using value_type		= typename MapValue::value_type;
+		using difference_type	= typename MapValue::difference_type;
+		using reference			= value_type&;
+		using pointer			= value_type*;
+
+		using Base::Base;
+
+		[[nodiscard]] reference operator*() const noexcept {
+			return const_cast<reference>(Base::operator*());
+		}
+
+		[[nodiscard]] pointer operator->() const noexcept {
+			return const_cast<pointer>(Base::operator->());
+		}
+
+		RadixMapIterator& operator++() noexcept {
+			Base::operator++();
+			return *this;
+		}
+
+		RadixMapIterator operator++(int) noexcept {
+			RadixMapIterator tmp = *this;
+			++*this;
+			return tmp;
+		}
+
+		RadixMapIterator& operator--() noexcept {
+			Base::operator--();
+			return *this;
+		}
+
+		RadixMapIterator operator--(int) noexcept {
+			RadixMapIterator tmp = *this;
+			--*this;
+			return tmp;
+		}
+	};
+
+	// An ordered map over the bytes of its keys (an adaptive radix tree): a lookup reads one byte of the key per level
+	// and never calls a comparator, and inner nodes come in four sizes, so sparse levels stay small. Chains of nodes
+	// with a single child are collapsed into a prefix of the node below. KeyTraits turns keys into bytes; integers and
+	// strings of chars are supported, and other keys need a specialization of RadixKeyTraits that keeps their order.
+	template<class Key, class T, class KeyTraits = RadixKeyTraits<Key>, class Allocator = std::allocator<std::pair<const Key, T>>>
+	class AdaptiveRadixMap {
+	public:
+		using allocator_type	= Allocator;
+		using key_type			= Key;
+		using mapped_type		= T;
+		using value_type		= std::pair<const Key, T>;
+
+	protected:
+		using MapValue			= RadixMapValue<Key, T, KeyTraits, Allocator>;
+		using Leaf				= typename MapValue::Leaf;
+		using Alloc				= typename MapValue::Alloc;
+		using AllocTraits		= typename MapValue::AllocTraits;
+		using Encoded			= typename MapValue::Encoded;
+
+	public:
+		using size_type			= typename MapValue::size_type;
+		using difference_type	= typename MapValue::difference_type;
+		using reference			= value_type&;
+		using const_reference	= const value_type&;
+
+		using iterator			= RadixMapIterator<MapValue>;
+		using const_iterator	= RadixMapConstIterator<MapValue>;
+
+		AdaptiveRadixMap() : AdaptiveRadixMap(Allocator{}) {}
+
+		explicit AdaptiveRadixMap(const Allocator& alloc) : map_value(alloc) {
+			createProxy();
+		}
+
+		template<class InputIt>
+		AdaptiveRadixMap(InputIt first, InputIt last, const Allocator& alloc = Allocator()) : AdaptiveRadixMap(alloc) {
+			insert(first, last);
+		}
+
+		AdaptiveRadixMap(std::initializer_list<value_type> init, const Allocator& alloc = Allocator()) : AdaptiveRadixMap(alloc) {
+			insert(init.begin(), init.end());
+		}
+
+		AdaptiveRadixMap(const AdaptiveRadixMap& other) : AdaptiveRadixMap(AllocTraits::select_on_container_copy_construction(other.map_value.alloc)) {
+			copyAll(other);
+		}
+
+		AdaptiveRadixMap(AdaptiveRadixMap&& other) : map_value(other.map_value.alloc) {
+			createProxy();
+			swapMapValue(other);
+		}
+
+		AdaptiveRadixMap& operator=(const AdaptiveRadixMap& other) {
+			if (this == &other) return *this;
+
+			clear();
+			if constexpr (!AllocTraits::is_always_equal::value && AllocTraits::propagate_on_container_copy_assignment::value) {
+				if (map_value.alloc != other.map_value.alloc) {
+					deleteProxy();
+					map_value.alloc = other.map_value.alloc;
+					createProxy();
+				}
+			}
+			copyAll(other);
+			return *this;
+		}
+
+		AdaptiveRadixMap& operator=(AdaptiveRadixMap&& other) {
+			if (this == &other) return *this;
+
+			clear();
+			if constexpr (!AllocTraits::is_always_equal::value) {
+				if (map_value.alloc != other.map_value.alloc) {
+					if constexpr (AllocTraits::propagate_on_container_move_assignment::value) {
+						deleteProxy();
+						map_value.alloc = std::move(other.map_value.alloc);
+						createProxy();
+					}
+					else {
+						copyAll(other);
+						other.clear();
+						return *this;
+					}
+				}
+			}
+			swapMapValue(other);
+			return *this;
+		}
+
+		~AdaptiveRadixMap() {
+			clear();
+			deleteProxy();
+		}
+
+		void swap(AdaptiveRadixMap& other) {
+			if (this == &other) return;
+			if constexpr (!AllocTraits::propagate_on_container_swap::value) assert(!"propagate_on_container_swap = false");
+
+			std::swap(map_value.alloc, other.map_value.alloc);
+			swapMapValue(other);
+		}
+
+		template<class InputIt>
+		void insert(InputIt first, InputIt last) {
+			for (; first != last; ++first) insert(*first);
+		}
+
+		void insert(std::initializer_list<value_type> init) {
+			insert(init.begin(), init.end());
+		}
+
+		std::pair<iterator, bool> insert(const value_type& value) {
+			return tryEmplace_(value.first, value.second);
+		}
+
+		std::pair<iterator, bool> insert(value_type&& value) {
+			return tryEmplace_(value.first, std::move(value.second));
+		}
+
+		// The value is built before the lookup, as its key may only come out of the arguments that way
+		template<class... Args>
+		std::pair<iterator, bool> emplace(Args&&... args) {
+			Leaf* leaf = map_value.createLeaf(std::forward<Args>(args)...);
+			std::pair<Leaf*, bool> result;
+			try {
+				result = map_value.findOrInsert(leaf->value.first, [leaf] { return leaf; });
+			}
+			catch (...) {
+				map_value.freeLeaf(leaf);
+				throw;
+			}
+			if (!result.second) map_value.freeLeaf(leaf);
+			return { iterator(&map_value, result.first), result.second };
+		}
+
+		template<class... Args>
+		std::pair<iterator, bool> tryEmplace(const key_type& key, Args&&... args) {
+			return tryEmplace_(key, std::forward<Args>(args)...);
+		}
+
+		template<class... Args>
+		std::pair<iterator, bool> tryEmplace(key_type&& key, Args&&... args) {
+			return tryEmplace_(std::move(key), std::forward<Args>(args)...);
+		}
+
+		template<class M>
+		std::pair<iterator, bool> insertOrAssign(const key_type& key, M&& obj) {
+			return insertOrAssign_(key, std::forward<M>(obj));
+		}
+
+		template<class M>
+		std::pair<iterator, bool> insertOrAssign(key_type&& key, M&& obj) {
+			return insertOrAssign_(std::move(key), std::forward<M>(obj));
+		}
+
+		T& operator[](const key_type& key) {
+			return tryEmplace_(key).first->second;
+		}
+
+		T& operator[](key_type&& key) {
+			return tryEmplace_(std::move(key)).first->second;
+		}
+
+		[[nodiscard]] T& at(const key_type& key) {
+			Leaf* leaf = findLeaf(key);
+			if (!leaf) throw std::out_of_range("Invalid key");
+			return leaf->value.second;
+		}
+
+		[[nodiscard]] const T& at(const key_type& key) const {
+			Leaf* leaf = findLeaf(key);
+			if (!leaf) throw std::out_of_range("Invalid key");
+			return leaf->value.second;
+		}
+
+		iterator erase(const_iterator iter) {
+			assert(iter.getContainer() == &map_value && "Iterator from another container");
+			assert(iter.leaf && "Cannot erase the end");
+			Leaf* leaf = iter.leaf;
+			Leaf* next = leaf->next;
+			eraseLeaf(leaf);
+			return iterator(&map_value, next);
+		}
+
+		iterator erase(iterator iter) {
+			return erase(const_iterator(iter));
+		}
+
+		iterator erase(const_iterator first, const_iterator last) {
+			assert(first.getContainer() == &map_value && last.getContainer() == &map_value && "Iterator from another container");
+			Leaf* leaf = first.leaf;
+			while (leaf != last.leaf) {
+				Leaf* next = leaf->next;
+				eraseLeaf(leaf);
+				leaf = next;
+			}
+			return iterator(&map_value, leaf);
+		}
+
+		size_type erase(const key_type& key) {
+			Leaf* leaf = findLeaf(key);
+			if (!leaf) return 0;
+			eraseLeaf(leaf);
+			return 1;
+		}
+
+		void clear() noexcept {
+			map_value.orphanAll();
+			map_value.freeSubtree(map_value.root);
+			map_value.root			= {};
+			map_value.first_leaf	= nullptr;
+			map_value.last_leaf		= nullptr;
+			map_value.size			= 0;
+		}
+
+		[[nodiscard]] iterator find(const key_type& key) noexcept {
+			return iterator(&map_value, findLeaf(key));
+		}
+
+		[[nodiscard]] const_iterator find(const key_type& key) const noexcept {
+			return const_iterator(&map_value, findLeaf(key));
+		}
+
+		[[nodiscard]] bool contains(const key_type& key) const noexcept {
+			return findLeaf(key) != nullptr;
+		}
+
+		[[nodiscard]] size_type count(const key_type& key) const noexcept {
+			return contains(key);
+		}
+
+		[[nodiscard]] iterator lowerBound(const key_type& key) noexcept {
+			return iterator(&map_value, lowerBoundLeaf(key));
+		}
+
+		[[nodiscard]] const_iterator lowerBound(const key_type& key) const noexcept {
+			return const_iterator(&map_value, lowerBoundLeaf(key));
+		}
+
+		[[nodiscard]] iterator upperBound(const key_type& key) noexcept {
+			return iterator(&map_value, upperBoundLeaf(key));
+		}
+
+		[[nodiscard]] const_iterator upperBound(const key_type& key) const noexcept {
+			return const_iterator(&map_value, upperBoundLeaf(key));
+		}
+
+		[[nodiscard]] iterator begin() noexcept {
+			return iterator(&map_value, map_value.first_leaf);
+		}
+
+		[[nodiscard]] const_iterator begin() const noexcept {
+			return const_iterator(&map_value, map_value.first_leaf);
+		}
+
+		[[nodiscard]] const_iterator cbegin() const noexcept {
+			return begin();
+		}
+
+		[[nodiscard]] iterator end() noexcept {
+			return iterator(&map_value, nullptr);
+		}
+
+		[[nodiscard]] const_iterator end() const noexcept {
+			return const_iterator(&map_value, nullptr);
+		}
+
+		[[nodiscard]] const_iterator cend() const noexcept {
+			return end();
+		}
+
+		[[nodiscard]] size_type size() const noexcept {
+			return map_value.size;
+		}
+
+		[[nodiscard]] bool empty() const noexcept {
+			return !map_value.size;
+		}
+
+		[[nodiscard]] allocator_type getAllocator() const noexcept {
+			return static_cast<allocator_type>(map_value.alloc);
+		}
+
+	protected:
+		template<class K, class... Args>
+		std::pair<iterator, bool> tryEmplace_(K&& key, Args&&... args) {
+			std::pair<Leaf*, bool> result = map_value.findOrInsert(key, [&] {
+				return map_value.createLeaf(std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+			});
+			return { iterator(&map_value, result.first), result.second };
+		}
+
+		template<class K, class M>
+		std::pair<iterator, bool> insertOrAssign_(K&& key, M&& obj) {
+			std::pair<Leaf*, bool> result = map_value.findOrInsert(key, [&] {
+				return map_value.createLeaf(std::forward<K>(key), std::forward<M>(obj));
+			});
+			if (!result.second) result.first->value.second = std::forward<M>(obj);
+			return { iterator(&map_value, result.first), result.second };
+		}
+
+		[[nodiscard]] Leaf* findLeaf(const key_type& key) const noexcept {
+			const Encoded encoded = KeyTraits::encode(key);
+			return map_value.findLeaf(RadixKeyBytes(encoded));
+		}
+
+		[[nodiscard]] Leaf* lowerBoundLeaf(const key_type& key) const noexcept {
+			const Encoded encoded = KeyTraits::encode(key);
+			return map_value.lowerBoundLeaf(RadixKeyBytes(encoded));
+		}
+
+		[[nodiscard]] Leaf* upperBoundLeaf(const key_type& key) const noexcept {
+			const Encoded encoded = KeyTraits::encode(key);
+			const RadixKeyBytes bytes(encoded);
+			Leaf* leaf = map_value.lowerBoundLeaf(bytes);
+			if (leaf && RadixKeyBytes(MapValue::encode(leaf)) == bytes) leaf = leaf->next;
+			return leaf;
+		}
+
+		void eraseLeaf(Leaf* leaf) noexcept {
+			map_value.orphanLeaf(leaf);
+			map_value.extractLeaf(leaf);
+			map_value.freeLeaf(leaf);
+		}
+
+		void copyAll(const AdaptiveRadixMap& other) {
+			if (!other.map_value.root) return;
+
+			try {
+				map_value.cloneSubtree(map_value.root, other.map_value.root);
+			}
+			catch (...) {
+				clear();
+				throw;
+			}
+		}
+
+		void swapMapValue(AdaptiveRadixMap& other) noexcept {
+			std::swap(map_value.root, other.map_value.root);
+			std::swap(map_value.first_leaf, other.map_value.first_leaf);
+			std::swap(map_value.last_leaf, other.map_value.last_leaf);
+			std::swap(map_value.size, other.map_value.size);
+			std::swap(map_value.proxy, other.map_value.proxy);
+
+			other.map_value.proxy->parent = &other.map_value;
+			map_value.proxy->parent = &map_value;
+		}
+
+		void createProxy() {
+			map_value.createProxy(static_cast<typename AllocTraits::template rebind_alloc<IteratorProxy>>(map_value.alloc));
+		}
+
+		void deleteProxy() {
+			map_value.orphanAll();
+			map_value.deleteProxy(static_cast<typename AllocTraits::template rebind_alloc<IteratorProxy>>(map_value.alloc));
+		}
+
+		MapValue map_value;
+	};
+}
\ No newline at end of file
@@ -11,10 +11,19 @@ namespace mylib {
 
 	template<class Key, class First>
 	struct KeyExtractorUnorderedSet<Key, First> {
-		static const bool extractable = std::is_same_v<Key, std::decay_t<First>>;
+		using key_type	= Key;
+		using Converter	= KeyConverter<Key, First>;
 
-		static const Key& extract(const First& value) {
-			return value;
+		static const bool extractable = Converter::convertible;
+
+		template<bool Views>
+		static decltype(auto) extract(const First& value) {
+			return Converter::template convert<Views>(value);
+		}
+
+		template<class ArgType>
+		static auto replaceKey(Key&& key, ArgType&&) {
+			return std::forward_as_tuple(std::move(key));
 		}
 	};
 
@@ -90,6 +99,13 @@ namespace mylib {
 			}
 		}
 
+		void reset(NodePtr head) noexcept {
+			for (size_type i = 0; i < size_; ++i) {
+				ptr_[i].first_	= head;
+				ptr_[i].last_	= head;
+			}
+		}
+
 		void checkGrow(size_type size) const noexcept {
 			assert(maxSize() >= size && "The lack of memory");
 		}
@@ -104,6 +120,7 @@ namespace mylib {
 					destroy(alloc_, ptr_ + i);
 				}
 				alloc_.deallocate(ptr_, size_);
+				ptr_ = nullptr;
 			}
 		}
 
@@ -159,10 +176,8 @@ namespace mylib {
 		template<class AnyAlloc>
 		Hash(const Hash& other, AnyAlloc&& alloc) : list_{ std::forward<AnyAlloc>(alloc) }, vector_{ std::forward<AnyAlloc>(alloc) },
 												    max_load_factor_{ other.max_load_factor_ }, hash_{ other.hash_ }, equal_{ other.equal_ } {
-			const NodePtr list_head = list_.list_value.head;
-			list_.insertRange(list_head, other.begin(), other.end());
-			vector_.resize(other.bucketCount(), list_head);
-			rehashHashVector();
+			vector_.resize(other.bucketCount(), list_.list_value.head);
+			copyOrMoveBuckets(other, CopyTag{});
 		}
 
 		template<class AnyAlloc>
@@ -172,10 +187,10 @@ namespace mylib {
 
 			if constexpr (!AllocTraits::is_always_equal::value) {
 				if (vector_.alloc_ != other.vector_.alloc_) {
-					list_.insertRange(list_head, other.begin(), other.end(), MoveTag{});
 					vector_.resize(other.bucketCount(), list_head);
-					rehashHashVector();
+					copyOrMoveBuckets(other, MoveTag{});
 					other.clear();
+					return;
 				}
 			}
 
@@ -184,6 +199,8 @@ namespace mylib {
 		}
 
 		Hash& operator=(const Hash& other) {
+			if (this == &other) return *this;
+
 			max_load_factor_ = other.max_load_factor_;
 			hash_ = other.hash_;
 			equal_ = other.equal_;
@@ -195,23 +212,20 @@ namespace mylib {
 						list_.list_value.alloc = other.list_.list_value.alloc;
 						vector_.alloc_ = other.vector_.alloc_;
 						list_.createEmptyList();
-						const NodePtr list_head = list_.list_value.head;
-						list_.insertRange(list_head, other.begin(), other.end());
-						vector_.resize(other.bucketCount(), list_head);
-						rehashHashVector();
+						vector_.resize(other.bucketCount(), list_.list_value.head);
+						copyOrMoveBuckets(other, CopyTag{});
 						return *this;
 					}
 				}
 			}
 
-			list_.copyOrMoveList(other.list_, CopyTag{});
-			const size_type other_bucket_count = other.bucketCount();
-			if (bucketCount() != other_bucket_count) vector_.resize(other_bucket_count, list_.list_value.head);
-			rehashHashVector();
+			copyBucketsReusingNodes(other);
 			return *this;
 		}
 
 		Hash& operator=(Hash&& other) {
+			if (this == &other) return *this;
+
 			if constexpr (!AllocTraits::is_always_equal::value) {
 				if (vector_.alloc_ != other.vector_.alloc_) {
 					max_load_factor_ = other.max_load_factor_;
@@ -223,17 +237,11 @@ namespace mylib {
 						list_.list_value.alloc = std::move(other.list_.list_value.alloc);
 						vector_.alloc_ = std::move(other.vector_.alloc_);
 						list_.createEmptyList();
-						const NodePtr list_head = list_.list_value.head;
-						list_.insertRange(list_head, other.begin(), other.end(), MoveTag{});
-						vector_.resize(other.bucketCount(), list_head);
-					}
-					else {
-						list_.copyOrMoveList(other.list_, MoveTag{});
-						const size_type other_bucket_count = other.bucketCount();
-						if (bucketCount() != other_bucket_count) vector_.resize(other_bucket_count, list_.list_value.head);
+						vector_.resize(other.bucketCount(), list_.list_value.head);
 					}
+					else clearForCopy(other.bucketCount());
 
-					rehashHashVector();
+					copyOrMoveBuckets(other, MoveTag{});
 					other.clear();
 					return *this;
 				}
@@ -255,7 +263,78 @@ namespace mylib {
 			vector_.resize(min_buckets_, list_head);
 		}
 
-		[[nodiscard]] FindResult<NodePtr> findPlace(const key_type& key) const noexcept {
+		void clearForCopy(size_type bucket_count) {
+			const NodePtr list_head = list_.list_value.head;
+			list_.clear();
+			if (bucketCount() != bucket_count) vector_.resize(bucket_count, list_head);
+			else vector_.reset(list_head);
+		}
+
+		// Clones other bucket by bucket into an empty list with the same bucket count. Every bucket is a contiguous run
+		// of the list, so the copied run can be linked straight into the same bucket without hashing a single key.
+		template<class Tag>
+		void copyOrMoveBuckets(const Hash& other, Tag tag) {
+			using uncheked_iterator = typename List::uncheked_iterator;
+
+			const NodePtr list_head		= list_.list_value.head;
+			const NodePtr other_head	= other.list_.list_value.head;
+			const size_type bucket_count = other.bucketCount();
+
+			for (size_type i = 0; i < bucket_count; ++i) {
+				const VectorValue& other_bucket = other.vector_.ptr_[i];
+				if (other_bucket.first_ == other_head) continue;
+
+				VectorValue& bucket = vector_.ptr_[i];
+				bucket.first_	= list_.insertRange(list_head, uncheked_iterator{ nullptr, other_bucket.first_ }, uncheked_iterator{ nullptr, other_bucket.last_->next }, tag);
+				bucket.last_	= list_head->prev;
+			}
+		}
+
+		// Does what clearForCopy and copyOrMoveBuckets do, but makes the copies in the nodes of the old list first
+		void copyBucketsReusingNodes(const Hash& other) {
+			const NodePtr list_head		= list_.list_value.head;
+			const NodePtr other_head	= other.list_.list_value.head;
+			const size_type bucket_count = other.bucketCount();
+
+			list_.list_value.orphanNonHead();
+			ListReuseNodes reuse(list_.list_value.alloc, list_head);
+			list_.list_value.size = 0;
+
+			if (bucketCount() != bucket_count) vector_.resize(bucket_count, list_head);
+			else vector_.reset(list_head);
+
+			try {
+				for (size_type i = 0; i < bucket_count; ++i) {
+					const VectorValue& other_bucket = other.vector_.ptr_[i];
+					if (other_bucket.first_ == other_head) continue;
+
+					VectorValue& bucket = vector_.ptr_[i];
+					const NodePtr last = other_bucket.last_->next;
+					for (NodePtr ptr = other_bucket.first_; ptr != last; ptr = ptr->next) {
+						const NodePtr node = reuse.reuseOrCreate(ptr->value);
+						node->prev				= list_head->prev;
+						node->next				= list_head;
+						list_head->prev->next	= node;
+						list_head->prev			= node;
+						++list_.list_value.size;
+
+						if (bucket.first_ == list_head) bucket.first_ = node;
+						bucket.last_ = node;
+					}
+				}
+			}
+			catch (...) {
+				clear();
+				throw;
+			}
+		}
+
+		// std::hash and std::equal_to of a string agree with those of its view, so emplace looks views of its arguments up
+		// through std::hash<view> and operator==
+		static constexpr bool compares_views = std::is_same_v<hasher, std::hash<key_type>> && std::is_same_v<key_equal, std::equal_to<key_type>>;
+
+		template<class K>
+		[[nodiscard]] FindResult<NodePtr> findPlace(const K& key) const noexcept {
 			VectorValue* bucket = getBucket(key);
 
 			FindResult<NodePtr> result{ nullptr, bucket };
@@ -265,7 +344,7 @@ namespace mylib {
 			if (ptr == list_.list_value.head) return result;	
 
 			while (ptr != last) {
-				if (equal_(Traits::getKeyFromValue(ptr->value), key)) {
+				if (keysEqual(Traits::getKeyFromValue(ptr->value), key)) {
 					result.duplicate = ptr;
 					return result;
 				}
@@ -274,11 +353,24 @@ namespace mylib {
 			return result;
 		}
 
-		[[nodiscard]] VectorValue* getBucket(const key_type& key) const noexcept {
-			size_type vector_index = static_cast<size_type>(hash_(key)) % bucketCount();
+		template<class K>
+		[[nodiscard]] VectorValue* getBucket(const K& key) const noexcept {
+			size_type vector_index = static_cast<size_type>(hashKey(key)) % bucketCount();
 			return vector_.ptr_ + vector_index;
 		}
 
+		template<class K>
+		[[nodiscard]] std::size_t hashKey(const K& key) const noexcept {
+			if constexpr (std::is_same_v<K, key_type>) return hash_(key);
+			else return std::hash<K>{}(key);
+		}
+
+		template<class K>
+		[[nodiscard]] bool keysEqual(const key_type& lhs, const K& rhs) const noexcept {
+			if constexpr (std::is_same_v<K, key_type>) return equal_(lhs, rhs);
+			else return lhs == rhs;
+		}
+
 		std::pair<iterator, bool> insert(const value_type& value) {
 			return emplace(value_type);
 		}
@@ -308,9 +400,12 @@ namespace mylib {
 			ListTmpNodes tmp_node(list_.list_value.alloc);
 
 			if constexpr (KeyExtractor::extractable) {
-				result = findPlace(KeyExtractor::extract(std::forward<Args>(args)...));
+				auto&& key = KeyExtractor::template extract<compares_views>(args...);
+				result = findPlace(key);
 				if (result.duplicate) return { { &list_.list_value, result.duplicate }, false };
-				tmp_node.createNode(std::forward<Args>(args)...);
+				makeWithLookupKey<KeyExtractor>(std::forward<decltype(key)>(key), [&tmp_node](auto&&... value_args) {
+					tmp_node.createNode(std::forward<decltype(value_args)>(value_args)...);
+				}, std::forward<Args>(args)...);
 			}
 			else {
 				tmp_node.createNode(std::forward<Args>(args)...);
@@ -318,20 +413,37 @@ namespace mylib {
 				if (result.duplicate) return { { &list_.list_value, result.duplicate }, false };
 			}
 
+			new_node = insertNode(result.bucket, tmp_node);
+			return { { &list_.list_value, new_node}, true };
+		}
+
+		template<class... Args>
+		NodePtr emplaceNode(VectorValue* bucket, Args&&... args) {
+			ListTmpNodes tmp_node(list_.list_value.alloc);
+			tmp_node.createNode(std::forward<Args>(args)...);
+			return insertNode(bucket, tmp_node);
+		}
+
+		template<class TmpNodes>
+		NodePtr insertNode(VectorValue* bucket, TmpNodes& tmp_node) {
 			const size_type size = ++list_.list_value.size;
 			const NodePtr list_head = list_.list_value.head;
 
 			if (checkRehash()) {
 				vector_.resize(getRequiredBucketsAmount(size), list_head);
 				rehashHashVector();
-				result = findPlace(Traits::getKeyFromValue(tmp_node.first->value));
+				bucket = getBucket(Traits::getKeyFromValue(tmp_node.first->value));
 			}
-			new_node = tmp_node.insertNodes(result.bucket->first_);
+			const NodePtr new_node = tmp_node.insertNodes(bucket->first_);
 
-			if (result.bucket->last_ == list_head) result.bucket->last_ = new_node;
-			result.bucket->first_ = new_node;
+			if (bucket->last_ == list_head) bucket->last_ = new_node;
+			bucket->first_ = new_node;
 
-			return { { &list_.list_value, new_node}, true };
+			return new_node;
+		}
+
+		[[nodiscard]] iterator makeIterator(NodePtr node) noexcept {
+			return { &list_.list_value, node };
 		}
 
 		iterator erase(const_iterator pos) {
@@ -394,6 +506,83 @@ namespace mylib {
 			return 0;
 		}
 
+		// Sweeps the buckets in index order, so every bucket is repaired from its own run without hashing a key,
+		// and the erased nodes are orphaned and freed together at the end.
+		template<class Predicate>
+		size_type eraseIf_(Predicate&& pred) {
+			const NodePtr list_head = list_.list_value.head;
+			const size_type bucket_count = bucketCount();
+			NodePtr erased{};
+			size_type count = 0;
+
+			for (size_type i = 0; i < bucket_count; ++i) {
+				VectorValue& bucket = vector_.ptr_[i];
+				if (bucket.first_ == list_head) continue;
+
+				NodePtr node			= bucket.first_;
+				const NodePtr last_node = bucket.last_->next;
+				bucket.first_			= list_head;
+				bucket.last_			= list_head;
+
+				while (node != last_node) {
+					const NodePtr next_node = node->next;
+					if (pred(node->value)) {
+						erased = list_.unlinkNode(node, erased);
+						++count;
+					}
+					else {
+						if (bucket.first_ == list_head) bucket.first_ = node;
+						bucket.last_ = node;
+					}
+					node = next_node;
+				}
+			}
+
+			list_.eraseUnlinked(erased, count);
+			return count;
+		}
+
+		template<class Predicate>
+		size_type eraseIf(Predicate pred) {
+			return eraseIf_(pred);
+		}
+
+		// The predicate is evaluated on thread_count threads at once, so it must be safe to call concurrently.
+		template<class Predicate>
+		size_type eraseIf(Predicate pred, unsigned thread_count) {
+			const NodePtr list_head = list_.list_value.head;
+			const size_type bucket_count = bucketCount();
+
+			std::vector<NodePtr> nodes;
+			nodes.reserve(size());
+			for (size_type i = 0; i < bucket_count; ++i) {
+				const VectorValue& bucket = vector_.ptr_[i];
+				if (bucket.first_ == list_head) continue;
+
+				for (NodePtr node = bucket.first_; node != bucket.last_->next; node = node->next) {
+					nodes.push_back(node);
+				}
+			}
+
+			std::vector<unsigned char> erase_flags(nodes.size());
+			parallelFor(nodes.size(), thread_count, [&](std::size_t first, std::size_t last) {
+				for (; first != last; ++first) erase_flags[first] = pred(nodes[first]->value) ? 1 : 0;
+			});
+
+			std::size_t index = 0;
+			return eraseIf_([&](const value_type&) { return erase_flags[index++] != 0; });
+		}
+
+		template<class Predicate>
+		size_type retain(Predicate pred) {
+			return eraseIf_([&pred](value_type& value) { return !pred(value); });
+		}
+
+		template<class Predicate>
+		size_type retain(Predicate pred, unsigned thread_count) {
+			return eraseIf([&pred](value_type& value) { return !pred(value); }, thread_count);
+		}
+
 		[[nodiscard]] iterator find(const key_type& key) noexcept {
 			FindResult<NodePtr> result = findPlace(key);
 			return result.duplicate ? iterator{ &list_.list_value, result.duplicate } : end();
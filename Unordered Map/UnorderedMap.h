@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdexcept>
 #include "Hash.h"
 
 namespace mylib {
@@ -9,21 +10,57 @@ namespace mylib {
 		static const bool extractable = false;
 	};
 
-	template<class Key, class Second>
-	struct KeyExtractorUnorderedMap<Key, Key, Second> {
-		static const bool extractable = true;
+	template<class Key, class First, class Second>
+	struct KeyExtractorUnorderedMap<Key, First, Second> {
+		using key_type	= Key;
+		using Converter	= KeyConverter<Key, First>;
+
+		static const bool extractable = Converter::convertible;
+
+		template<bool Views>
+		static decltype(auto) extract(const First& first, const Second&) {
+			return Converter::template convert<Views>(first);
+		}
 
-		static const Key& extract(const Key& key, const Second& second) {
-			return key;
+		template<class FirstArg, class SecondArg>
+		static auto replaceKey(Key&& key, FirstArg&&, SecondArg&& second) {
+			return std::forward_as_tuple(std::move(key), std::forward<SecondArg>(second));
 		}
 	};
 
 	template<class Key, class First, class Second>
 	struct KeyExtractorUnorderedMap<Key, std::pair<First, Second>> {
-		static const bool extractable = std::is_same_v<Key, typename std::decay_t<First>>;
+		using key_type	= Key;
+		using Converter	= KeyConverter<Key, std::decay_t<First>>;
 
-		static const Key& extract(const std::pair<First, Second>& value) {
-			return value.first;
+		static const bool extractable = Converter::convertible;
+
+		template<bool Views>
+		static decltype(auto) extract(const std::pair<First, Second>& value) {
+			return Converter::template convert<Views>(value.first);
+		}
+
+		template<class Pair>
+		static auto replaceKey(Key&& key, Pair&& value) {
+			return std::forward_as_tuple(std::move(key), std::get<1>(std::forward<Pair>(value)));
+		}
+	};
+
+	template<class Key, class... KeyArgs, class ValueArgs>
+	struct KeyExtractorUnorderedMap<Key, std::piecewise_construct_t, std::tuple<KeyArgs...>, ValueArgs> {
+		using key_type	= Key;
+		using Converter	= KeyConverter<Key, std::decay_t<KeyArgs>...>;
+
+		static const bool extractable = Converter::convertible;
+
+		template<bool Views>
+		static decltype(auto) extract(std::piecewise_construct_t, const std::tuple<KeyArgs...>& key_args, const ValueArgs&) {
+			return std::apply([](const auto&... args) -> decltype(auto) { return Converter::template convert<Views>(args...); }, key_args);
+		}
+
+		template<class KeyTuple, class ValueTuple>
+		static auto replaceKey(Key&& key, std::piecewise_construct_t, KeyTuple&&, ValueTuple&& value_args) { // the key tuple is held by value
+			return std::tuple<std::piecewise_construct_t, std::tuple<Key&&>, ValueTuple&&>(std::piecewise_construct, std::tuple<Key&&>(std::move(key)), std::forward<ValueTuple>(value_args));
 		}
 	};
 
@@ -56,10 +93,15 @@ namespace mylib {
 		using allocator_type	= typename Base::allocator_type;
 		using AllocTraits		= std::allocator_traits<allocator_type>;
 		using size_type			= typename AllocTraits::size_type;
+		using mapped_type		= T;
 		using List				= List<value_type, allocator_type>;
 		using const_iterator	= typename List::const_iterator;
 		using iterator			= typename List::iterator;
-	
+
+	protected:
+		using NodePtr			= typename Base::NodePtr;
+
+	public:
 
 		UnorderedMap() : Base(this->min_buckets_, Hash{}, key_equal{}, Allocator{}) {}
 
@@ -92,6 +134,10 @@ namespace mylib {
 
 		UnorderedMap(UnorderedMap&& other, const Allocator& alloc) : Base(std::move(other), alloc) {}
 
+		UnorderedMap& operator=(const UnorderedMap& other) = default;
+
+		UnorderedMap& operator=(UnorderedMap&& other) = default;
+
 		UnorderedMap(std::initializer_list<value_type> init, size_type bucket_count = this->min_buckets_, Hash hash = Hash{}, key_equal equal = key_equal{},
 			const Allocator& alloc = Allocator{}) : Base(init.begin(), init.end(), bucket_count, hash, equal, alloc) {}
 
@@ -100,5 +146,68 @@ namespace mylib {
 
 		UnorderedMap(std::initializer_list<value_type> init, size_type bucket_count, Hash hash, const Allocator& alloc)
 			: Base(init.begin(), init.end(), bucket_count, hash, key_equal{}, alloc) {}
+
+		template<class... Args>
+		std::pair<iterator, bool> tryEmplace(const key_type& key, Args&&... args) {
+			std::pair<NodePtr, bool> result = tryEmplace_(key, std::forward<Args>(args)...);
+			return { this->makeIterator(result.first), result.second };
+		}
+
+		template<class... Args>
+		std::pair<iterator, bool> tryEmplace(key_type&& key, Args&&... args) {
+			std::pair<NodePtr, bool> result = tryEmplace_(std::move(key), std::forward<Args>(args)...);
+			return { this->makeIterator(result.first), result.second };
+		}
+
+		template<class M>
+		std::pair<iterator, bool> insertOrAssign(const key_type& key, M&& obj) {
+			std::pair<NodePtr, bool> result = insertOrAssign_(key, std::forward<M>(obj));
+			return { this->makeIterator(result.first), result.second };
+		}
+
+		template<class M>
+		std::pair<iterator, bool> insertOrAssign(key_type&& key, M&& obj) {
+			std::pair<NodePtr, bool> result = insertOrAssign_(std::move(key), std::forward<M>(obj));
+			return { this->makeIterator(result.first), result.second };
+		}
+
+		T& operator[](const key_type& key) {
+			return tryEmplace_(key).first->value.second;
+		}
+
+		T& operator[](key_type&& key) {
+			return tryEmplace_(std::move(key)).first->value.second;
+		}
+
+		[[nodiscard]] T& at(const key_type& key) {
+			FindResult<NodePtr> result = this->findPlace(key);
+			if (!result.duplicate) throw std::out_of_range("Invalid key");
+			return result.duplicate->value.second;
+		}
+
+		[[nodiscard]] const T& at(const key_type& key) const {
+			FindResult<NodePtr> result = this->findPlace(key);
+			if (!result.duplicate) throw std::out_of_range("Invalid key");
+			return result.duplicate->value.second;
+		}
+
+	protected:
+		template<class K, class... Args>
+		std::pair<NodePtr, bool> tryEmplace_(K&& key, Args&&... args) {
+			FindResult<NodePtr> result = this->findPlace(key);
+			if (result.duplicate) return { result.duplicate, false };
+			return { this->emplaceNode(result.bucket, std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+				std::forward_as_tuple(std::forward<Args>(args)...)), true };
+		}
+
+		template<class K, class M>
+		std::pair<NodePtr, bool> insertOrAssign_(K&& key, M&& obj) {
+			FindResult<NodePtr> result = this->findPlace(key);
+			if (result.duplicate) {
+				result.duplicate->value.second = std::forward<M>(obj);
+				return { result.duplicate, false };
+			}
+			return { this->emplaceNode(result.bucket, std::forward<K>(key), std::forward<M>(obj)), true };
+		}
 	};
 }
\ No newline at end of file